@@ -12,14 +12,16 @@
 
 //Uncomment to enter debug mode
 //#define DEBUG
+//#define BINARY_LOG    //Send prints as a format id + raw arguments. SpinorGUI cannot read them, decode them with a host tool built on Simple::LogTable
 
-void radio_print(const char* fmt, ...);
-#define print(fmt, ...) radio_print(fmt, ##__VA_ARGS__)
+template<typename F, typename... Args> void radio_print(F fmt, Args... args);
+#define print(fmt, ...) radio_print(SimpleFormat(fmt), ##__VA_ARGS__)
 #define printct(fmt, ...) print("[Cntrl]:" fmt, ##__VA_ARGS__)
 #define printctln(fmt, ...) println("[Cntrl]:" fmt, ##__VA_ARGS__)
 
 #include <SimpleConnection.hpp>
 #include <SimpleTimer.hpp>
+#include <SimpleLog.hpp>
 #include <devices/SimpleFeather.hpp>
 
 #include <SPI.h>
@@ -35,7 +37,8 @@ enum PacketType : uint8_t{
   AccelerationPacket = 1,
   ComputerPrint,
   SetMotorSpeed,
-  Cut
+  Cut,
+  ComputerLog = 6
 };
 
 enum Device : uint8_t{
@@ -53,9 +56,9 @@ struct CntrlRxRadioConnection : public RadioConnection{
 
   CntrlRxRadioConnection() : RadioConnection(RFM95_Slave, RFM95_Interrupt, RFM95_Reset, 256) { SetAddress(Ctrlr); }
 
-    void SendPacket(RadioPacket* p){
+    bool SendPacket(RadioPacket* p){
       p->SeekStart();
-      Send(p);
+      return Send(p);
     }
 
   void Receive(RadioPacket* io) final;
@@ -70,15 +73,15 @@ Timer packetTimer(true, 5000);
 RadioPacket rp1 = RadioPacket(256);
 
 //Simple::Printf implementation stream to Rx
-void radio_print(const char* fmt, ...){
-  va_list args;
-  va_start(args, fmt);
-
+template<typename F, typename... Args> void radio_print(F fmt, Args... args){
+#ifdef BINARY_LOG
+  rp1.config(Rxer, PacketType::ComputerLog);
+  Log::Write(rp1, fmt, args...);
+#else
   rp1.config(Rxer, PacketType::ComputerPrint);
-  rp1.vPrintf((char*) fmt, args);
+  rp1.Printf(fmt, args...);
+#endif
   cntrl.SendPacket(&rp1);
-
-  va_end(args);
 }
 
 void set_motor_speed(uint8_t speed){
@@ -31,7 +31,12 @@ const uint8_t TAIL_MAGIC_NUMBER = 0xEE;
 
 namespace Simple {
     struct Packet : public IOArray{
-        explicit Packet(int capacity = 256) : IOArray(capacity){}
+        /**$headroom bytes are kept free in front of the payload and $tailroom bytes behind it so that
+         * the layers below can add their headers and trailers without moving the payload**/
+        explicit Packet(int capacity = 256, int headroom = 0, int tailroom = 0) : IOArray(capacity, headroom, tailroom){}
+        Packet(ref<uint8_t> heap_ref, int capacity) : IOArray(std::move(heap_ref), capacity){}
+        /**Packet in memory from $from (a Pool or Arena) so busy links do not churn the heap**/
+        Packet(Allocator& from, int capacity, int headroom = 0, int tailroom = 0) : IOArray(from, capacity, headroom, tailroom){}
 
         void config(bool reset = true){
             if(reset)
@@ -39,69 +44,390 @@ namespace Simple {
         }
     };
 
+    /**Bounded queue that any number of threads push into and one thread pops from, without locks (Vyukov). Each cell
+     * carries a sequence number that says whose turn it is, so producers only race for the enqueue index**/
+    template<typename T, int Capacity>
+    struct LockFreeRing{
+        static_assert(Capacity > 1 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+        LockFreeRing() : enqueue(0){
+            for(size_t i = 0; i < Capacity; i++)
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        LockFreeRing(const LockFreeRing&) = delete;
+        ~LockFreeRing(){
+            T rest;
+            while(Pop(&rest));
+        }
+
+        /**Move $v in. Return false if it is full, $v is left as it was**/
+        bool Push(T& v){
+            auto pos = enqueue.load(std::memory_order_relaxed);
+            Cell* c;
+            while(true){
+                c = &cells[pos & (Capacity - 1)];
+                auto turn = (intptr_t) c->sequence.load(std::memory_order_acquire) - (intptr_t) pos;
+                if(turn == 0){
+                    if(enqueue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }else if(turn < 0){
+                    overflows.fetch_add(1, std::memory_order_relaxed);
+                    return false;                                   //The consumer has not freed the cell yet
+                }
+                else pos = enqueue.load(std::memory_order_relaxed); //Another producer took it
+            }
+            new (&c->value) T(std::move(v));
+            c->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**Consumer: move the oldest value into $out. Return false if it is empty**/
+        bool Pop(T* out){
+            auto c = &cells[dequeue & (Capacity - 1)];
+            if(c->sequence.load(std::memory_order_acquire) != dequeue + 1)
+                return false;
+            auto v = (T*) &c->value;
+            *out = std::move(*v);
+            v->~T();
+            c->sequence.store(dequeue + Capacity, std::memory_order_release);
+            dequeue++;
+            return true;
+        }
+
+        /**Consumer: if there is nothing to pop**/
+        inline bool Empty() const { return cells[dequeue & (Capacity - 1)].sequence.load(std::memory_order_acquire) != dequeue + 1; }
+
+        /**Pushes turned away because it was full**/
+        inline uint32_t Overflows() const { return overflows.load(std::memory_order_relaxed); }
+
+    private:
+        struct Cell{
+            std::atomic<size_t> sequence;
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type value;
+        };
+
+        Cell cells[Capacity];
+        uint8_t pad[64];                            //Keep the producers' index off the cells and the consumer's line
+        std::atomic<size_t> enqueue;
+        uint8_t pad2[64];
+        size_t dequeue = 0;                         //Only the consumer touches it
+        std::atomic<uint32_t> overflows{0};
+    };
+
+    /**Bounded queue for one core. Interrupts are masked for the few instructions a push or pop takes, so interrupts
+     * of any priority and the loop can all push. Needs no compare and swap, which a Cortex M0 does not have**/
+    template<typename T, int Capacity>
+    struct MaskedRing{
+        static_assert(Capacity > 1 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+        MaskedRing(){}
+        MaskedRing(const MaskedRing&) = delete;
+        ~MaskedRing(){
+            T rest;
+            while(Pop(&rest));
+        }
+
+        bool Push(T& v){
+            Guard<InterruptLock> g(lock);
+            if(head - tail == Capacity){
+                overflows++;                        //Under the lock, so a Cortex M0 needs no atomic libcall
+                return false;
+            }
+            new (Slot(head)) T(std::move(v));
+            head++;
+            return true;
+        }
+
+        bool Pop(T* out){
+            Guard<InterruptLock> g(lock);
+            if(head == tail)
+                return false;
+            auto v = Slot(tail);
+            *out = std::move(*v);
+            v->~T();
+            tail++;
+            return true;
+        }
+
+        inline bool Empty() const { return head == tail; }
+
+        /**Pushes turned away because it was full**/
+        inline uint32_t Overflows() const { return overflows; }
+
+    private:
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type slots[Capacity];
+        volatile uint32_t head = 0, tail = 0;       //Free running
+        volatile uint32_t overflows = 0;
+        InterruptLock lock;
+
+        inline T* Slot(uint32_t i){ return (T*) &slots[i & (Capacity - 1)]; }
+    };
+
+/**Boards mask interrupts, the PC is lock free**/
+#ifdef ARDUINO
+    template<typename T, int Capacity> using PlatformRing = MaskedRing<T, Capacity>;
+#else
+    template<typename T, int Capacity> using PlatformRing = LockFreeRing<T, Capacity>;
+#endif
+
+    /**Hands messages from other threads or interrupts to the loop. Post never blocks or allocates, and it wakes a loop
+     * idling in Task::Idle. The receiver runs on the loop during Yield. Use it like this
+     *  PacketQueue<> decoded([](ref<Packet>& p){ Log(*p); });
+     *  decoded.Post(packet);      //From the serial thread **/
+    template<typename T, int Capacity = 16, template<typename, int> class Ring = PlatformRing>
+    struct MessageQueue : public Task{
+        InlineLambda<void(T&)> receiver;
+
+        explicit MessageQueue(InlineLambda<void(T&)> receiver = nullptr) : receiver(std::move(receiver)){ Start(); }
+
+        /**Producer: move $message in. Return false and count an overflow if the queue is full, $message is left as it was**/
+        bool Post(T& message){
+            if(!ring.Push(message))
+                return false;                       //The ring counts it
+            NativeWake();
+            return true;
+        }
+        bool Post(T&& message){ return Post(message); }
+
+        /**Consumer: take the oldest message yourself. Return false if there is none**/
+        inline bool Take(T* out){ return ring.Pop(out); }
+        inline bool Empty() const { return ring.Empty(); }
+
+        /**Messages dropped because the queue was full**/
+        inline uint32_t Overflows() const { return ring.Overflows(); }
+
+        /**Hand at most Capacity messages to the receiver, so producers that keep posting cannot hold the loop here**/
+        TaskReturn Fire() override {
+            for(int n = 0; n < Capacity; n++){
+                T message;
+                if(!ring.Pop(&message))
+                    break;
+                if(receiver)
+                    receiver(message);
+            }
+            return Nothing;
+        }
+
+        /**Post wakes the loop, so an empty queue needs no polling**/
+        uint32_t IdleFor() override { return ring.Empty() ? Never : 0; }
+
+    private:
+        Ring<T, Capacity> ring;
+    };
+
+    /**Queue of packet handles between threads or from an interrupt to the loop**/
+    template<int Capacity = 16> using PacketQueue = MessageQueue<ref<Packet>, Capacity>;
+
+    struct DeferredCall{
+        void (*call)(uint32_t argument);
+        uint32_t argument;
+    };
+
+    /**Fixed capacity queue of calls interrupts or threads hand to the loop. Post never blocks or allocates and wakes the
+     * loop, so it is safe in interrupts of any priority. The calls run on the next Yield in the order they were posted,
+     * at most Capacity per pass. When the queue is full the call is dropped and counted. Use it like this
+     *  DeferQueue<16> deferred;
+     *  void onPulse(){ deferred.Post([](uint32_t t){ println("Pulse at %u", t); }, micros()); }
+     * **/
+    template<int Capacity = 16>
+    struct DeferQueue : public MessageQueue<DeferredCall, Capacity>{
+        typedef void (*Call)(uint32_t argument);
+
+        DeferQueue() : MessageQueue<DeferredCall, Capacity>([](DeferredCall& c){ c.call(c.argument); }){}
+
+        /**Producer: Queue $call($argument). Return false and count an overflow if the queue is full**/
+        bool Post(Call call, uint32_t argument = 0){ return MessageQueue<DeferredCall, Capacity>::Post(DeferredCall{call, argument}); }
+    };
+
     class Connection : public Task{
     public:
         virtual void Write(IO* p) = 0;
-        virtual void Send(Packet* p){ Write(p); }
+
+        /**Write several slices back to back. Override this if the port can take the slices without gathering them**/
+        virtual void WriteV(IOSlice* slices, int count){
+            SliceIO io(slices, count);
+            Write(&io);
+        }
+
+        /**Returns false if the packet was dropped instead of sent**/
+        virtual bool Send(Packet* p){ Write(p); return true; }
         virtual void Receive(Packet* p) = 0;
         TaskReturn Fire() override { return TaskReturn::Nothing; }
+
+        /**A port that cannot wake the device is polled every millisecond. Connections whose port wakes the device when
+         * bytes come in (an interrupt, or a descriptor in IdleWatch on the PC) return Never**/
+        uint32_t IdleFor() override { return 1; }
     };
 
-    class SimpleConnection : public Connection{
-        IOArray write_buffer;
-        Packet read_buffer;
-    public:
+    /**Resumable frame decoder. Every incoming byte is looked at exactly once and the stream is never rewound,
+     * so a frame that arrives in many small chunks costs the same as one that arrives whole.
+     * Frame Layout: [MAGIC_NUMBER (4, network order)] [Length (1)] [Payload (Length)] [TAIL_MAGIC_NUMBER (1)]**/
+    struct FrameDecoder{
+        enum State : uint8_t { Hunting, Header, Payload, Tail };
+
+        Packet frame;
 
-        explicit SimpleConnection(int capacity = 256) : write_buffer(capacity), read_buffer(capacity){}
+        explicit FrameDecoder(int capacity = 256) : frame(capacity){}
 
-        void Send(Packet* p) override {
-            write_buffer.Clear();
-            write_buffer.WriteStd(MAGIC_NUMBER);
-            write_buffer.Write<uint8_t>(0);
+        inline State GetState() const { return state; }
 
-            auto start = write_buffer.Position();
-            write_buffer.ReadFrom(*p);
-            auto length = write_buffer.Position() - start;
-            *write_buffer.Interpret(4) = length;                //Position of the size
+        /**Drop any partially decoded frame and start hunting for the next magic number**/
+        void Reset(){
+            state = Hunting;
+            matched = 0;
+            ready = false;
+        }
 
-            write_buffer.WriteStd<uint8_t>(TAIL_MAGIC_NUMBER);
+        /**Consume bytes until a frame completes or the buffer runs out. Returns the bytes consumed.
+         * If a frame completed, Ready() is true and the payload is either at View() inside $data (when the whole
+         * payload arrived in this buffer) or in frame [0, Length) **/
+        int Feed(const uint8_t* data, int length){
+            auto ptr = data, end = data + length;
+            ready = false;
+            view = nullptr;
 
-            write_buffer.SeekStart();
+            while(ptr < end){
+                switch(state){
+                    case Hunting:{
+                        if(matched == 0){
+                            //Skip junk in bulk until a possible start of the magic number
+                            ptr = (const uint8_t*) memchr(ptr, MagicByte(0), end - ptr);
+                            if(ptr == nullptr)
+                                return length;
+                        }
+                        auto b = *(ptr++);
+                        if(b == MagicByte(matched)){
+                            if(++matched == sizeof(MAGIC_NUMBER))
+                                state = Header;
+                        }else matched = b == MagicByte(0) ? 1 : 0;      //Magic number does not overlap with itself
+                        break;
+                    }
+                    case Header:
+                        remaining = *(ptr++);
+                        matched = 0;
+                        frame.Clear();
+                        state = remaining == 0 ? Tail : (remaining <= frame.Capacity() ? Payload : Hunting);
+                        break;
+                    case Payload:{
+                        if(frame.Size() == 0 && end - ptr > remaining && ptr[remaining] == TAIL_MAGIC_NUMBER){
+                            view = ptr;                             //Point at the payload instead of copying it
+                            view_length = remaining;
+                            state = Hunting;
+                            ready = true;
+                            return (ptr + remaining + sizeof(TAIL_MAGIC_NUMBER)) - data;
+                        }
+                        auto n = min((int) (end - ptr), (int) remaining);
+                        frame.WriteBytes((uint8_t*) ptr, n);
+                        ptr += n;
+                        remaining -= n;
+                        if(remaining == 0)
+                            state = Tail;
+                        break;
+                    }
+                    case Tail:
+                        state = Hunting;
+                        if(*(ptr++) == TAIL_MAGIC_NUMBER){
+                            frame.SeekStart();
+                            ready = true;
+                            return ptr - data;
+                        }
+                        break;
+                }
+            }
 
-            Write(&write_buffer);
+            return ptr - data;
         }
 
-        void Receive(Packet* io) override {
-            read_buffer.SeekEnd();
-            read_buffer.ReadFrom(*io);
-            read_buffer.SeekStart();
+        /**If the last Feed completed a frame**/
+        inline bool Ready() const { return ready; }
 
-            uint32_t maybe_number = 0;
+        /**Payload of the completed frame inside the fed buffer or nullptr if it was copied to frame**/
+        inline const uint8_t* View() const { return view; }
+        inline int ViewLength() const { return view_length; }
 
-            while(read_buffer.TryReadStd(&maybe_number) && maybe_number != MAGIC_NUMBER)
-                read_buffer.SeekDelta(-3);   //Read next byte
+        /**Byte $i of the magic number as it appears on the wire**/
+        static inline uint8_t MagicByte(int i){ return (uint8_t) (MAGIC_NUMBER >> (8 * (sizeof(MAGIC_NUMBER) - 1 - i))); }
 
-            uint8_t read_size = 0;
-            if(maybe_number == MAGIC_NUMBER && read_buffer.TryReadStd(&read_size)){
-                auto pos = read_buffer.Position();
-                uint8_t tail = 0;
+    private:
+        State state = Hunting;
+        uint8_t matched = 0, remaining = 0, view_length = 0;
+        const uint8_t* view = nullptr;
+        bool ready = false;
+    };
 
-                read_buffer.SeekDelta(read_size);
-                if(!read_buffer.TryReadStd(&tail)) return;
-                read_buffer.Seek(pos);
+    class SimpleConnection : public Connection{
+        FrameDecoder decoder;
+    public:
 
-                if(tail == TAIL_MAGIC_NUMBER){
-                    auto rbs = read_buffer.Size();
-                    read_buffer.SetBytesAvailable(read_size);
-                    ReceivedMessage(&read_buffer);
-                    read_buffer.SetSize(rbs);
+        explicit SimpleConnection(int capacity = 256) : decoder(capacity){}
 
-                    read_buffer.Seek(pos + read_size + sizeof(TAIL_MAGIC_NUMBER));
-                }
+        /**Bytes a packet needs in front of and behind its payload to be framed in place**/
+        static const int Headroom = sizeof(MAGIC_NUMBER) + 1, Tailroom = sizeof(TAIL_MAGIC_NUMBER);
+        /**Most slices SendV frames in one go and the longest payload the length byte can carry**/
+        static const int MaxSlices = 8, MaxPayload = UINT8_MAX;
 
-                read_buffer.ClearToPosition();
-            }else
-                read_buffer.ClearToPosition();      //Junk Data
+        /**Returns false without writing anything if the packet does not fit in a frame, see SendV**/
+        bool Send(Packet* p) override {
+            int length = p->BytesAvailable();
+            if(p->Position() == 0 && p->Headroom() >= Headroom && p->Tailroom() >= Tailroom && length <= MaxPayload){
+                //Frame the packet in place and write it as one slice. Only the headroom and tailroom are written to
+                auto mark = p->Save();
+                auto header = p->Prepend(Headroom);
+                for(int i = 0; i < (int) sizeof(MAGIC_NUMBER); i++)
+                    header[i] = FrameDecoder::MagicByte(i);
+                header[sizeof(MAGIC_NUMBER)] = length;
+                *p->Append(Tailroom) = TAIL_MAGIC_NUMBER;
+
+                IOSlice frame = {p->Interpret(0), (int) p->Size()};
+                WriteV(&frame, 1);
+                p->Restore(mark);
+                return true;
+            }
+            IOSlice payload = {p->Begin(), length};
+            return SendV(&payload, 1);
+        }
+
+        /**Frame the slices as one message and write it without copying the payload. Returns false without writing
+         * anything if there are more than MaxSlices slices or more than MaxPayload bytes (the length is one byte)**/
+        bool SendV(IOSlice* payload, int count){
+            if(count > MaxSlices)
+                return false;
+            int length = 0;
+            for(int i = 0; i < count; i++)
+                length += payload[i].nbytes;
+            if(length > MaxPayload)
+                return false;
+
+            uint8_t header[sizeof(MAGIC_NUMBER) + 1], tail = TAIL_MAGIC_NUMBER;
+            for(int i = 0; i < (int) sizeof(MAGIC_NUMBER); i++)
+                header[i] = FrameDecoder::MagicByte(i);
+            header[sizeof(MAGIC_NUMBER)] = length;
+
+            IOSlice frame[MaxSlices + 2];
+            frame[0] = {header, sizeof(header)};
+            for(int i = 0; i < count; i++)
+                frame[i + 1] = payload[i];
+            frame[count + 1] = {&tail, sizeof(tail)};
+
+            WriteV(frame, count + 2);
+            return true;
+        }
+
+        void Receive(Packet* io) override {
+            while(io->BytesAvailable() > 0){
+                io->SeekDelta(decoder.Feed(io->Begin(), io->BytesAvailable()));
+                if(!decoder.Ready())
+                    continue;
+                if(decoder.View() != nullptr){
+                    //Narrow the incoming packet to the payload instead of copying it out
+                    auto mark = io->Save();
+                    io->Strip(decoder.View() - io->Interpret(0));
+                    io->SetSize(decoder.ViewLength());
+                    io->SeekStart();
+                    ReceivedMessage(io);
+                    io->Restore(mark);
+                }else ReceivedMessage(&decoder.frame);
+            }
         }
 
         virtual void ReceivedMessage(Packet* io) = 0;
@@ -113,6 +439,8 @@ namespace Simple {
     public:
         explicit ConnectionIO(IO* io) : io(io){}
 
+        void WriteV(IOSlice* slices, int count) override { io->WriteBytesV(slices, count); }
+
     protected:
         void Write(IO* in) override { io->ReadFrom(*in); }
     };
@@ -0,0 +1,356 @@
+/**********************************************************************
+   NAME: SimpleConvert.hpp
+   AUTHOR: Johnathan Bizzano
+   DATE: 10/17/2026
+
+    The Simple Project
+		Medium Level (from Low) library that abstracts away from embedded device hardware
+
+    Simple Convert
+		Number to text conversion used by IO::Print*. Integers are written back to front two digits at a time
+		without divide instructions. Floats print at a fixed precision or, where 128 bit multiplies exist (PC),
+		as the shortest string that reads back to the same double (Grisu2)
+*********************************************************************/
+
+#ifndef SIMPLE_CONVERT_H
+#define SIMPLE_CONVERT_H
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SIZEOF_INT128__) && !defined(SIMPLE_FIXED_FLOAT)
+    #define SIMPLE_SHORTEST_FLOAT
+#endif
+
+namespace Simple{
+    namespace Convert{
+        /**Size of a buffer that fits any number printed by Convert (with the terminator)**/
+        static constexpr int BufferSize = 32;
+
+        /**Precision meaning "shortest round trip". Falls back to Trimmed without SIMPLE_SHORTEST_FLOAT**/
+        static constexpr int Shortest = -1;
+        /**Precision meaning DefaultPrecision digits with the trailing zeros dropped. What %f prints, so a float does not
+         * show the noise of its double (0.1f is 0.10000000149011612 shortest)**/
+        static constexpr int Trimmed = -2;
+        static constexpr int DefaultPrecision = 4;
+        static constexpr int MaxPrecision = 9;
+
+        static const char DigitPairs[201] =
+            "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+            "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+            "8081828384858687888990919293949596979899";
+
+        static const uint32_t Pow10[10] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+        /**$v / 100 as a multiply and shift. Below 43699 the product fits in 32 bits, so no 64 bit multiply is needed**/
+        inline uint32_t Div100(uint32_t v){
+            return v < 43699 ? (v * 5243u) >> 19 : (uint32_t) (((uint64_t) v * 1374389535u) >> 37);
+        }
+
+        inline void WritePair(char* p, uint32_t v){ memcpy(p, DigitPairs + 2 * v, 2); }
+
+        inline int CountDigits(uint32_t v){
+            int n = 1;
+            while(n < 10 && v >= Pow10[n])
+                n++;
+            return n;
+        }
+
+        /**Write exactly $width digits of $v (< 10^width) to $p, zero padded**/
+        inline void UInt32Padded(char* p, uint32_t v, int width){
+            p += width;
+            for(; width >= 2; width -= 2){
+                uint32_t q = Div100(v);
+                p -= 2;
+                WritePair(p, v - q * 100);
+                v = q;
+            }
+            if(width == 1)
+                *--p = (char) ('0' + v);
+        }
+
+        /**Write $v to $buffer and return the chars written (not counting the terminator)**/
+        inline int UInt32(char* buffer, uint32_t v){
+            int n = CountDigits(v);
+            UInt32Padded(buffer, v, n);
+            buffer[n] = '\0';
+            return n;
+        }
+
+        /**Write $v to $buffer and return the chars written. Only values past 32 bits pay for a 64 bit divide**/
+        inline int UInt64(char* buffer, uint64_t v){
+            if(v <= 0xFFFFFFFFu)
+                return UInt32(buffer, (uint32_t) v);
+            uint64_t hi = v / 100000000;
+            int n = UInt64(buffer, hi);
+            UInt32Padded(buffer + n, (uint32_t) (v - hi * 100000000), 8);
+            buffer[n + 8] = '\0';
+            return n + 8;
+        }
+
+        inline int Int64(char* buffer, int64_t v){
+            if(v < 0){
+                buffer[0] = '-';
+                return 1 + UInt64(buffer + 1, 0 - (uint64_t) v);
+            }
+            return UInt64(buffer, (uint64_t) v);
+        }
+
+        inline int Copy(char* buffer, const char* s){
+            int n = (int) strlen(s);
+            memcpy(buffer, s, n + 1);
+            return n;
+        }
+
+        /**Write non negative $d with $precision digits after the point. Trailing zeros are dropped if $trim**/
+        inline int Fixed(char* buffer, double d, int precision, bool trim){
+            if(precision > MaxPrecision)
+                precision = MaxPrecision;
+            char* p = buffer;
+
+            int exponent = 0;
+            if(d >= 1E18){              //Past 64 bits. Print as d.ddd e N. Rare enough to scale slowly
+                while(d >= 10){
+                    d /= 10;
+                    exponent++;
+                }
+            }
+
+            auto units = (uint64_t) d;
+            auto scale = Pow10[precision];
+            auto decimals = (uint32_t) ((d - (double) units) * scale + 0.5);
+            if(decimals >= scale){
+                units++;
+                decimals -= scale;
+            }
+
+            if(trim){
+                while(precision > 0 && decimals % 10 == 0){
+                    decimals /= 10;
+                    precision--;
+                }
+            }
+
+            p += UInt64(p, units);
+            if(precision > 0){
+                *p++ = '.';
+                UInt32Padded(p, decimals, precision);
+                p += precision;
+            }
+            if(exponent > 0){
+                *p++ = 'e';
+                p += UInt32(p, exponent);
+            }
+            *p = '\0';
+            return (int) (p - buffer);
+        }
+
+#ifdef SIMPLE_SHORTEST_FLOAT
+        /**Grisu2 (Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with Integers")**/
+        namespace Grisu{
+            typedef unsigned __int128 uint128_t;
+
+            struct DiyFp{
+                uint64_t f;
+                int e;
+            };
+
+            static constexpr uint64_t HiddenBit = (uint64_t) 1 << 52;
+            static constexpr uint64_t SignificandMask = HiddenBit - 1;
+
+            inline DiyFp Multiply(DiyFp a, DiyFp b){
+                auto p = (uint128_t) a.f * b.f;
+                return {(uint64_t) (p >> 64) + (((uint64_t) p) >> 63), a.e + b.e + 64};
+            }
+
+            inline DiyFp Normalize(DiyFp v){
+                int shift = __builtin_clzll(v.f);
+                return {v.f << shift, v.e - shift};
+            }
+
+            /**10^k for k = -348, -340, ... 340 as normalized 64 bit mantissas.
+             * Built once by stepping a 128 bit mantissa by 10 so the 64 bits kept are correctly rounded**/
+            struct CachedPowers{
+                DiyFp powers[87];
+
+                CachedPowers(){
+                    uint128_t m = (uint128_t) 1 << 127;
+                    int e = -127;
+                    for(int k = 0; k < 348; k++){
+                        uint128_t q = m / 10, r = m % 10;
+                        int shift = __builtin_clzll((uint64_t) (q >> 64));
+                        m = (q << shift) + ((r << shift) / 10);
+                        e -= shift;
+                    }
+                    for(int k = -348, i = 0; i < 87; k++){
+                        if((k + 348) % 8 == 0)
+                            powers[i++] = Round(m, e);
+                        m = ((m >> 4) + ((m >> 3) & 1)) * 10;
+                        e += 4;
+                        if((m >> 127) == 0){
+                            m <<= 1;
+                            e--;
+                        }
+                    }
+                }
+
+                static DiyFp Round(uint128_t m, int e){
+                    auto f = (uint64_t) (m >> 64);
+                    if(((uint64_t) m >> 63) != 0 && ++f == 0)
+                        return {(uint64_t) 1 << 63, e + 65};
+                    return {f, e + 64};
+                }
+            };
+
+            inline DiyFp CachedPower(int e, int* K){
+                static const CachedPowers cache;
+                double dk = (-61 - e) * 0.30102999566398114 + 347;
+                int k = (int) dk;
+                if(dk - k > 0.0)
+                    k++;
+                unsigned index = (unsigned) ((k >> 3) + 1);
+                *K = -(-348 + (int) (index << 3));
+                return cache.powers[index];
+            }
+
+            inline void Round(char* buffer, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w){
+                while(rest < wp_w && delta - rest >= ten_kappa &&
+                      (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)){
+                    buffer[len - 1]--;
+                    rest += ten_kappa;
+                }
+            }
+
+            inline void DigitGen(DiyFp W, DiyFp Mp, uint64_t delta, char* buffer, int* len, int* K){
+                const DiyFp one = {(uint64_t) 1 << -Mp.e, Mp.e};
+                const uint64_t wp_w = Mp.f - W.f;
+                auto p1 = (uint32_t) (Mp.f >> -one.e);
+                uint64_t p2 = Mp.f & (one.f - 1);
+                int kappa = CountDigits(p1);
+                *len = 0;
+
+                while(kappa > 0){
+                    uint32_t d = p1 / Pow10[kappa - 1];
+                    p1 %= Pow10[kappa - 1];
+                    if(d || *len)
+                        buffer[(*len)++] = (char) ('0' + d);
+                    kappa--;
+                    uint64_t tmp = ((uint64_t) p1 << -one.e) + p2;
+                    if(tmp <= delta){
+                        *K += kappa;
+                        Round(buffer, *len, delta, tmp, (uint64_t) Pow10[kappa] << -one.e, wp_w);
+                        return;
+                    }
+                }
+
+                uint64_t unit = 1;
+                while(true){
+                    p2 *= 10;
+                    delta *= 10;
+                    unit *= 10;
+                    auto d = (char) (p2 >> -one.e);
+                    if(d || *len)
+                        buffer[(*len)++] = (char) ('0' + d);
+                    p2 &= one.f - 1;
+                    kappa--;
+                    if(p2 < delta){
+                        *K += kappa;
+                        Round(buffer, *len, delta, p2, one.f, wp_w * unit);
+                        return;
+                    }
+                }
+            }
+
+            /**Shortest digits of positive finite $value. The value is digits * 10^K**/
+            inline void Digits(double value, char* buffer, int* length, int* K){
+                uint64_t bits;
+                memcpy(&bits, &value, sizeof(bits));
+                auto biased = (int) ((bits >> 52) & 0x7FF);
+                uint64_t significand = bits & SignificandMask;
+                DiyFp v = biased != 0 ? DiyFp{significand + HiddenBit, biased - 1075} : DiyFp{significand, -1074};
+
+                DiyFp plus = {(v.f << 1) + 1, v.e - 1};
+                while((plus.f & (HiddenBit << 1)) == 0){
+                    plus.f <<= 1;
+                    plus.e--;
+                }
+                plus.f <<= 64 - 52 - 2;
+                plus.e -= 64 - 52 - 2;
+                DiyFp minus = v.f == HiddenBit ? DiyFp{(v.f << 2) - 1, v.e - 2} : DiyFp{(v.f << 1) - 1, v.e - 1};
+                minus.f <<= minus.e - plus.e;
+                minus.e = plus.e;
+
+                DiyFp c = CachedPower(plus.e, K);
+                DiyFp W = Multiply(Normalize(v), c);
+                DiyFp Wp = Multiply(plus, c);
+                DiyFp Wm = Multiply(minus, c);
+                Wm.f++;
+                Wp.f--;
+                DigitGen(W, Wp, Wp.f - Wm.f, buffer, length, K);
+            }
+
+            /**Lay the digits out as 1234, 12.34, 0.001234 or 1.234e30**/
+            inline int Prettify(char* buffer, int length, int k){
+                const int kk = length + k;
+                if(0 <= k && kk <= 21){
+                    memset(buffer + length, '0', kk - length);
+                    buffer[kk] = '\0';
+                    return kk;
+                }else if(0 < kk && kk <= 21){
+                    memmove(buffer + kk + 1, buffer + kk, length - kk);
+                    buffer[kk] = '.';
+                    buffer[length + 1] = '\0';
+                    return length + 1;
+                }else if(-6 < kk && kk <= 0){
+                    const int offset = 2 - kk;
+                    memmove(buffer + offset, buffer, length);
+                    buffer[0] = '0';
+                    buffer[1] = '.';
+                    memset(buffer + 2, '0', offset - 2);
+                    buffer[length + offset] = '\0';
+                    return length + offset;
+                }
+
+                int n = 1;
+                if(length > 1){
+                    memmove(buffer + 2, buffer + 1, length - 1);
+                    buffer[1] = '.';
+                    n = length + 1;
+                }
+                buffer[n++] = 'e';
+                int exponent = kk - 1;
+                if(exponent < 0){
+                    buffer[n++] = '-';
+                    exponent = -exponent;
+                }
+                return n + UInt32(buffer + n, (uint32_t) exponent);
+            }
+        }
+#endif
+
+        /**Write $d with $precision digits after the point, the shortest round trip string for Shortest or Trimmed. Return the chars written**/
+        inline int Float64(char* buffer, double d, int precision = Shortest){
+            if(d != d)
+                return Copy(buffer, "nan");
+            int sign = 0;
+            if(d < 0){
+                buffer[sign++] = '-';
+                d = -d;
+            }
+            if(d > 1.7976931348623157E308)
+                return sign + Copy(buffer + sign, "inf");
+#ifdef SIMPLE_SHORTEST_FLOAT
+            if(precision == Shortest){
+                if(d == 0)
+                    return sign + Copy(buffer + sign, "0");
+                int length, K;
+                Grisu::Digits(d, buffer + sign, &length, &K);
+                return sign + Grisu::Prettify(buffer + sign, length, K);
+            }
+#endif
+            return sign + Fixed(buffer + sign, d, precision < 0 ? DefaultPrecision : precision, precision < 0);
+        }
+    }
+}
+
+#endif
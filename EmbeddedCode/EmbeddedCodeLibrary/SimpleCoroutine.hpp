@@ -0,0 +1,275 @@
+/**********************************************************************
+   NAME: SimpleCoroutine.hpp
+   AUTHOR: Johnathan Bizzano
+   DATE: 10/17/2026
+
+    The Simple Project
+		Medium Level (from Low) library that abstracts away from embedded device hardware
+
+    Simple Coroutine
+		Sequenced code that waits without blocking the loop. Coroutines are Tasks, so Yield runs them.
+		With C++20 a coroutine is a function returning CoTask that uses co_await. Older toolchains write the
+		body in Resume() with the coroutine_ macros (a protothread over a switch). Waiting never allocates
+*********************************************************************/
+
+#ifndef SIMPLE_COROUTINE_H
+#define SIMPLE_COROUTINE_H
+
+#include "SimpleTimer.hpp"
+#include "SimpleConnection.hpp"
+
+#ifdef __cpp_impl_coroutine
+    #include <coroutine>
+    #define SIMPLE_CO_AWAIT
+#endif
+
+namespace Simple{
+    struct Coroutine;
+
+    /**Hands received packets to a coroutine waiting on them. Call Deliver from Receive. The waiting coroutine runs
+     * right away while the packet is still valid**/
+    struct Inbox{
+        Coroutine* waiter = nullptr;
+        Packet* packet = nullptr;
+
+        /**Resume the coroutine waiting on this inbox with $p. Return false if none is waiting**/
+        inline bool Deliver(Packet* p);
+    };
+
+    /**A task that runs its body in steps. Between steps it waits on a deadline, a condition or an inbox**/
+    struct Coroutine : public Task{
+        Coroutine(){}
+        Coroutine(const Coroutine&) = delete;
+        ~Coroutine() override { Release(); }
+
+        /**Run the body from where it last stopped**/
+        virtual void Resume() = 0;
+
+        inline bool Done(){ return done; }
+
+        /**Run the body again from the top**/
+        void Restart(){
+            Release();
+            resume_point = 0;
+            done = false;
+            Start();
+        }
+
+        TaskReturn Fire() override {
+            if(inbox != nullptr || (timed && !TimerController::Due(wake, Clock64.Millis())) || (ready != nullptr && !ready(arg)))
+                return Nothing;
+            return Step();
+        }
+
+        uint32_t IdleFor() override {
+            if(inbox != nullptr)
+                return Never;
+            if(ready != nullptr)
+                return 0;
+            if(timed)
+                return TimerController::Until(wake, Clock64.Millis());
+            return 0;
+        }
+
+        /**Park until $milliseconds have passed**/
+        void Sleep(uint32_t milliseconds){
+            wake = Clock64.Millis() + milliseconds;
+            timed = true;
+        }
+
+        /**Park until $condition($argument) is true. It is checked every Yield**/
+        void Until(bool (*condition)(void*), void* argument){
+            ready = condition;
+            arg = argument;
+        }
+
+        /**Park until a packet is delivered to $box**/
+        void Await(Inbox* box){
+            inbox = box;
+            box->waiter = this;
+        }
+
+        /**Run one step now**/
+        TaskReturn Step(){
+            Release();
+            return Run();
+        }
+
+    protected:
+        /**Resume and retire the coroutine if it finished**/
+        virtual TaskReturn Run(){
+            Resume();
+            if(!done)
+                return Nothing;
+            Stop();
+            return Disposed;
+        }
+
+        uint16_t resume_point = 0;      //Line to continue from (coroutine_ macros)
+        bool done = false;
+
+    private:
+        TimerController::TimeT wake = 0;
+        bool timed = false;
+        bool (*ready)(void*) = nullptr;
+        void* arg = nullptr;
+        Inbox* inbox = nullptr;
+
+        void Release(){
+            timed = false;
+            ready = nullptr;
+            if(inbox != nullptr && inbox->waiter == this)
+                inbox->waiter = nullptr;
+            inbox = nullptr;
+        }
+    };
+
+    bool Inbox::Deliver(Packet* p){
+        if(waiter == nullptr)
+            return false;
+        auto w = waiter;
+        waiter = nullptr;
+        packet = p;
+        w->Step();
+        packet = nullptr;
+        return true;
+    }
+
+/**Protothread body for Coroutine::Resume. Locals do not survive a wait, keep state in members. Use it like this
+ *  void Resume() override {
+ *      coroutine_begin();
+ *      digitalWrite(CutPin, HIGH);
+ *      coroutine_wait(1000);
+ *      digitalWrite(CutPin, LOW);
+ *      coroutine_end();
+ *  } **/
+#define coroutine_begin() switch(resume_point){ case 0:
+
+/**Continue after $ms milliseconds**/
+#define coroutine_wait(ms)                                              \
+        do{ Sleep(ms); resume_point = __LINE__; return; case __LINE__:; }while(0)
+
+/**Continue once $condition is true**/
+#define coroutine_until(condition)                                      \
+        do{ resume_point = __LINE__; case __LINE__: if(!(condition)) return; }while(0)
+
+/**Continue once $io has bytes to read**/
+#define coroutine_readable(io) coroutine_until((io).BytesAvailable() > 0)
+
+/**Continue when a packet is delivered to $box and point $out at it. It is valid until the next wait**/
+#define coroutine_receive(box, out)                                     \
+        do{ Await(&(box)); resume_point = __LINE__; return; case __LINE__: out = (box).packet; }while(0)
+
+#define coroutine_end() } done = true
+
+#ifdef SIMPLE_CO_AWAIT
+    /**Handle to a C++20 coroutine running on the scheduler. The frame is allocated once when it is called. Use it like this
+     *  CoTask Cut(){
+     *      digitalWrite(CutPin, HIGH);
+     *      co_await Co::Wait(1000);
+     *      digitalWrite(CutPin, LOW);
+     *  } **/
+    struct CoTask{
+        struct promise_type : public Coroutine{
+            bool detached = false;
+            bool* finished = nullptr;       //Set by the final suspend. Lives outside the frame, which may be gone by then
+
+            CoTask get_return_object(){ return CoTask(Handle()); }
+            std::suspend_always initial_suspend(){
+                Start();                //First step runs on the next Yield
+                return {};
+            }
+            auto final_suspend() noexcept {
+                struct Final{
+                    bool detached;
+                    bool await_ready() noexcept { return detached; }        //A detached frame frees itself
+                    void await_suspend(std::coroutine_handle<>) noexcept {}
+                    void await_resume() noexcept {}
+                };
+                done = true;
+                Stop();
+                if(finished != nullptr)
+                    *finished = true;
+                return Final{detached};
+            }
+            void return_void(){}
+            void unhandled_exception(){}
+
+            void Resume() override { Handle().resume(); }
+
+        protected:
+            TaskReturn Run() override {
+                bool end = false;
+                finished = &end;
+                Handle().resume();
+                return end ? Disposed : Nothing;
+            }
+
+        private:
+            std::coroutine_handle<promise_type> Handle(){ return std::coroutine_handle<promise_type>::from_promise(*this); }
+        };
+
+        CoTask(CoTask&& o) noexcept : handle(o.handle){ o.handle = nullptr; }
+        CoTask& operator=(CoTask&& o) noexcept {
+            std::swap(handle, o.handle);
+            return *this;
+        }
+        ~CoTask(){
+            if(handle)
+                handle.destroy();
+        }
+
+        bool Done(){ return !handle || handle.done(); }
+        Coroutine& Routine(){ return handle.promise(); }
+
+        /**Let the coroutine run to the end on its own. It frees itself when it finishes**/
+        void Detach(){
+            if(handle.done())
+                handle.destroy();
+            else
+                handle.promise().detached = true;
+            handle = nullptr;
+        }
+
+    private:
+        std::coroutine_handle<promise_type> handle;
+        explicit CoTask(std::coroutine_handle<promise_type> h) : handle(h){}
+    };
+
+    namespace Co{
+        /**co_await Co::Wait(ms) continues after $ms milliseconds**/
+        struct Wait{
+            uint32_t ms;
+            explicit Wait(uint32_t ms) : ms(ms){}
+            bool await_ready(){ return false; }
+            template<typename P> void await_suspend(std::coroutine_handle<P> h){ h.promise().Sleep(ms); }
+            void await_resume(){}
+        };
+
+        /**co_await Co::Until(f) continues once f() is true. It is checked every Yield**/
+        template<typename F> struct UntilAwait{
+            F condition;
+            bool await_ready(){ return condition(); }
+            template<typename P> void await_suspend(std::coroutine_handle<P> h){
+                h.promise().Until([](void* f){ return (*(F*) f)(); }, &condition);
+            }
+            void await_resume(){}
+        };
+        template<typename F> inline UntilAwait<F> Until(F condition){ return UntilAwait<F>{condition}; }
+
+        /**co_await Co::Readable(io) continues once $io has bytes to read**/
+        template<typename TIO> inline auto Readable(TIO& io){ return Until([&io]{ return io.BytesAvailable() > 0; }); }
+
+        /**Packet* p = co_await Co::Receive(inbox) continues when a packet is delivered. It is valid until the next co_await**/
+        struct Receive{
+            Inbox& inbox;
+            explicit Receive(Inbox& inbox) : inbox(inbox){}
+            bool await_ready(){ return false; }
+            template<typename P> void await_suspend(std::coroutine_handle<P> h){ h.promise().Await(&inbox); }
+            Packet* await_resume(){ return inbox.packet; }
+        };
+    }
+#endif
+}
+
+#endif
@@ -0,0 +1,112 @@
+/**********************************************************************
+   NAME: SimpleEndian.hpp
+   AUTHOR: Johnathan Bizzano
+   DATE: 10/17/2026
+
+    The Simple Project
+		Medium Level (from Low) library that abstracts away from embedded device hardware
+
+    Simple Endian
+		Compile time byte order. Values cross the network big endian (the std order of WriteStd/ReadStd).
+		Single values swap with the bswap intrinsics and arrays are swapped in bulk in one pass
+*********************************************************************/
+
+#ifndef SIMPLE_ENDIAN_H
+#define SIMPLE_ENDIAN_H
+
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+#if !defined(__BYTE_ORDER__)
+    #error "Byte Order Not Defined! Please Define It. Set it to __ORDER_LITTLE_ENDIAN__ or __ORDER_BIG_ENDIAN__"
+#endif
+
+#ifdef __SSSE3__
+    #include <tmmintrin.h>
+#endif
+
+namespace Simple{
+    namespace Endian{
+        /**If values must be swapped to go from this machine to the network (std) order**/
+        static constexpr bool NetworkSwap = __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+
+        /**Types sent in std order. Everything else (enums, structs, 80 bit long doubles) is sent as raw bytes.
+         * Enums stay raw because the peers (SpinorGUI.jl included) read them that way**/
+        template<typename T> struct IsStd : std::integral_constant<bool, std::is_arithmetic<T>::value &&
+                                                                         (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8)>{};
+
+        inline uint8_t Swap(uint8_t v){ return v; }
+        inline uint16_t Swap(uint16_t v){ return __builtin_bswap16(v); }
+        inline uint32_t Swap(uint32_t v){ return __builtin_bswap32(v); }
+        inline uint64_t Swap(uint64_t v){ return __builtin_bswap64(v); }
+
+        /**Unsigned integer with the same size as T**/
+        template<int Size> struct Bits;
+        template<> struct Bits<1>{ typedef uint8_t type; };
+        template<> struct Bits<2>{ typedef uint16_t type; };
+        template<> struct Bits<4>{ typedef uint32_t type; };
+        template<> struct Bits<8>{ typedef uint64_t type; };
+
+        /**Reverse the bytes of a std value**/
+        template<typename T> inline T SwapBytes(T v){
+            typename Bits<sizeof(T)>::type bits;
+            memcpy(&bits, &v, sizeof(T));
+            bits = Swap(bits);
+            memcpy(&v, &bits, sizeof(T));
+            return v;
+        }
+
+        /**Reverse every $Size byte element of $src into $dst. $dst may be $src**/
+        template<int Size> inline void SwapArray(uint8_t* dst, const uint8_t* src, size_t count){
+            typedef typename Bits<Size>::type U;
+            size_t i = 0;
+#ifdef __SSSE3__
+            if(Size > 1){
+                const __m128i mask = Size == 2 ? _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14) :
+                                     Size == 4 ? _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12) :
+                                                 _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+                for(; (i + 16 / Size) <= count; i += 16 / Size){
+                    auto v = _mm_loadu_si128((const __m128i*) (src + i * Size));
+                    _mm_storeu_si128((__m128i*) (dst + i * Size), _mm_shuffle_epi8(v, mask));
+                }
+            }
+#endif
+            for(; i < count; i++){
+                U v;
+                memcpy(&v, src + i * Size, Size);
+                v = Swap(v);
+                memcpy(dst + i * Size, &v, Size);
+            }
+        }
+
+        /**If values of T must be swapped to go from this machine to the network (std) order**/
+        template<typename T> struct NeedsSwap : std::integral_constant<bool, NetworkSwap && IsStd<T>::value && (sizeof(T) > 1)>{};
+
+        /**Swap when Enable. Lets non std types pass through without instantiating the swaps**/
+        template<bool Enable> struct SwapIf{
+            template<typename T> static inline void Value(T*){}
+            template<typename T> static inline void Array(T* dst, const T* src, size_t count){
+                if(dst != src)
+                    memcpy(dst, src, count * sizeof(T));
+            }
+        };
+        template<> struct SwapIf<true>{
+            template<typename T> static inline void Value(T* v){ *v = SwapBytes(*v); }
+            template<typename T> static inline void Array(T* dst, const T* src, size_t count){ SwapArray<sizeof(T)>((uint8_t*) dst, (const uint8_t*) src, count); }
+        };
+
+        /**Convert between machine and network (std) order. The same operation both ways**/
+        template<typename T> inline T ToNetwork(T v){
+            SwapIf<NeedsSwap<T>::value>::Value(&v);
+            return v;
+        }
+        template<typename T> inline T FromNetwork(T v){ return ToNetwork(v); }
+
+        /**Convert $count values between machine and network order in one pass. $dst may be $src**/
+        template<typename T> inline void ToNetwork(T* dst, const T* src, size_t count){ SwapIf<NeedsSwap<T>::value>::Array(dst, src, count); }
+        template<typename T> inline void FromNetwork(T* dst, const T* src, size_t count){ ToNetwork(dst, src, count); }
+    }
+}
+
+#endif
@@ -0,0 +1,113 @@
+/**********************************************************************
+   NAME: SimpleFormat.hpp
+   AUTHOR: Johnathan Bizzano
+   DATE: 10/17/2026
+
+    The Simple Project
+		Medium Level (from Low) library that abstracts away from embedded device hardware
+
+    Simple Format
+		Compile time parsed format strings. The format is split into literal runs and typed argument slots
+		when the code is compiled so printing does not scan the format at runtime and mismatched
+		arguments are compile errors
+*********************************************************************/
+
+#ifndef SIMPLE_FORMAT_H
+#define SIMPLE_FORMAT_H
+
+#include <stdint.h>
+#include <type_traits>
+#include "SimpleConvert.hpp"
+
+namespace Simple{
+    /**Base of the types created by SimpleFormat. value() returns the format string literal**/
+    struct FormatString{};
+
+    namespace Format{
+        /**If $c is one of the conversions understood by Printf**/
+        constexpr bool IsSpec(char c){
+            return c == 'c' || c == 'b' || c == 'u' || c == 'i' || c == 'l' ||
+                   c == 'f' || c == 'p' || c == 'U' || c == 's' || c == 'd';
+        }
+
+        /**Index of the next conversion at or after $i or of the terminator if there is none**/
+        constexpr int NextSpec(const char* f, int i){
+            return f[i] == '\0' ? i : (f[i] == '%' && IsSpec(f[i + 1])) ? i : NextSpec(f, i + 1);
+        }
+
+        /**Number of conversions at or after $i**/
+        constexpr int CountSpecs(const char* f, int i = 0){
+            return f[NextSpec(f, i)] == '\0' ? 0 : 1 + CountSpecs(f, NextSpec(f, i) + 2);
+        }
+
+        /**If an argument of type T can be printed by conversion $c**/
+        template<typename T> constexpr bool Accepts(char c){
+            return (c == 'c' || c == 'i' || c == 'u' || c == 'l' || c == 'U') ? (std::is_integral<T>::value || std::is_enum<T>::value) :
+                   (c == 'b') ? std::is_integral<T>::value :
+                   (c == 'f' || c == 'd') ? std::is_floating_point<T>::value :
+                   (c == 's') ? (std::is_same<T, char*>::value || std::is_same<T, const char*>::value) :
+                   (c == 'p') ? std::is_pointer<T>::value : false;
+        }
+
+        /**Print one argument with conversion C**/
+        template<char C> struct Arg;
+        template<> struct Arg<'c'>{ template<typename TIO, typename T> static inline void Write(TIO& io, char*, T t){ io.WriteByte((uint8_t) t); } };
+        template<> struct Arg<'b'>{ template<typename TIO, typename T> static inline void Write(TIO& io, char*, T t){ io.WriteUnsafeString(t ? "true" : "false"); } };
+        template<> struct Arg<'i'>{ template<typename TIO, typename T> static inline void Write(TIO& io, char* b, T t){ io.PrintInt64(b, (int64_t) t); } };
+        template<> struct Arg<'l'> : Arg<'i'>{};
+        template<> struct Arg<'u'>{ template<typename TIO, typename T> static inline void Write(TIO& io, char* b, T t){ io.PrintUInt64(b, (uint64_t) t); } };
+        template<> struct Arg<'U'> : Arg<'u'>{};
+        template<> struct Arg<'f'>{ template<typename TIO, typename T> static inline void Write(TIO& io, char* b, T t){ io.PrintFloat64(b, (double) t, Convert::Trimmed); } };
+        template<> struct Arg<'d'>{ template<typename TIO, typename T> static inline void Write(TIO& io, char* b, T t){ io.PrintFloat64(b, (double) t); } };
+        template<> struct Arg<'p'>{ template<typename TIO, typename T> static inline void Write(TIO& io, char* b, T t){ io.PrintUInt64(b, (uint64_t) (uintptr_t) t); } };
+        template<> struct Arg<'s'>{ template<typename TIO, typename T> static inline void Write(TIO& io, char*, T t){ io.WriteUnsafeString(t); } };
+
+        /**Write the literal run [Start, End) of the format with one WriteBytes**/
+        template<typename F, int Start, int End> struct Literal{
+            template<typename TIO> static inline void Write(TIO& io){ io.WriteBytes((uint8_t*) F::value() + Start, End - Start); }
+        };
+        template<typename F, int Start> struct Literal<F, Start, Start>{
+            template<typename TIO> static inline void Write(TIO&){}
+        };
+
+        /**Walk the format from Pos, consuming one argument per conversion**/
+        template<typename F, int Pos, typename... Args> struct Writer;
+
+        template<typename F, int Pos> struct Writer<F, Pos>{
+            static constexpr int Spec = NextSpec(F::value(), Pos);
+            static_assert(F::value()[Spec] == '\0', "Format string has more conversions than arguments");
+
+            template<typename TIO> static inline void Write(TIO& io, char*){ Literal<F, Pos, Spec>::Write(io); }
+        };
+
+        template<typename F, int Pos, typename T, typename... Rest> struct Writer<F, Pos, T, Rest...>{
+            static constexpr int Spec = NextSpec(F::value(), Pos);
+            static constexpr char Conversion = F::value()[Spec] == '\0' ? '\0' : F::value()[Spec + 1];
+            static_assert(Conversion != '\0', "Format string has fewer conversions than arguments");
+            static_assert(Conversion == '\0' || Accepts<typename std::decay<T>::type>(Conversion), "Argument type does not match its format conversion");
+
+            template<typename TIO> static inline void Write(TIO& io, char* buffer, T t, Rest... rest){
+                Literal<F, Pos, Spec>::Write(io);
+                Arg<Conversion>::Write(io, buffer, t);
+                Writer<F, Spec + 2, Rest...>::Write(io, buffer, rest...);
+            }
+        };
+    }
+
+#ifdef __ELF__
+    #define SIMPLE_FORMAT_STR(x) #x
+    /**Add a format string to the .simple_log section of the elf. The section is not loaded onto the board, host tools
+     * copy it out of the elf. The literal is handed to the assembler as written, which joins adjacent literals the same way**/
+    #define SimpleFormatIntern(fmt) __asm__(".pushsection .simple_log,\"\",%progbits\n\t.ascii " SIMPLE_FORMAT_STR(fmt) "\n\t.byte 0\n\t.popsection")
+#else
+    #define SimpleFormatIntern(fmt)
+#endif
+
+/**Turn a format string literal into a compile time format for Printf. Intern() puts it in the format table of the elf
+ * Use it like this
+ *  io.Printf(SimpleFormat("Speed %i: %f"), id, speed); **/
+#define SimpleFormat(fmt) ([]{ struct __Format__ : public Simple::FormatString { static constexpr const char* value(){ return fmt; } \
+                                                                                static void Intern(){ SimpleFormatIntern(fmt); } }; return __Format__(); }())
+}
+
+#endif
@@ -24,15 +24,19 @@
 #include <array>
 #include <vector>
 #include <string>
+#include <atomic>
 
 #include "SimpleMath.hpp"
+#include "SimpleFormat.hpp"
+#include "SimpleConvert.hpp"
+#include "SimpleEndian.hpp"
 
 #ifndef print
-    #define print(fmt, ...) Out.Printf(fmt, ##__VA_ARGS__)
+    #define print(fmt, ...) Out.Printf(SimpleFormat(fmt), ##__VA_ARGS__)
 #endif
 
 #ifndef printerr
-    #define printerr(fmt, ...) Error.Printf(fmt, ##__VA_ARGS__)
+    #define printerr(fmt, ...) Error.Printf(SimpleFormat(fmt), ##__VA_ARGS__)
 #endif
 
 #define println(fmt, ...) print(fmt "\r\n", ##__VA_ARGS__)
@@ -42,57 +46,29 @@ namespace Simple {
     using namespace std;
 
     enum Endianness { BIG, LITTLE, Unknown };
-/*
-#ifndef __BYTE_ORDER__
-#error "Byte Order Not Defined! Please Define It. Set it to __ORDER_LITTLE_ENDIAN__ or __ORDER_BIG_ENDIAN__. Error will throw if its wrong"
-#endif
-*/
     static bool InitializeIO();
+    static void NativeInitializeIO();
+    static int NativeBytesAvailable(FILE* in);
 
+    struct IO;
     struct IOVector;
     struct IOArray;
     struct SeekableIO;
 
-    /**Base Implementation of a stream. Is a wrapper over ports
-     **/
-    struct IO {
-        /** Return the number of bytes that are in the stream that can be read **/
-        virtual int BytesAvailable() = 0;
-
-        /** Read bytes from the stream to a buffer without blocking. Return the bytes written **/
-        virtual int ReadBytesUnlocked(uint8_t *ptr, int buffer_size) = 0;
-
-        /** Write the bytes from this IO to another IO **/
-        virtual int WriteBytes(uint8_t *ptr, int nbytes) = 0;
-
-        /** Write a byte to the stream **/
-        int WriteByte(uint8_t b){ return WriteBytes(&b, 1); }
-
-        /** Read a byte from the stream **/
-        int ReadByte(){ uint8_t b; return ReadBytesUnlocked(&b, 1) == 1 ? b : -1; }
-
-        /** Read from another IO to this IO **/
-        int ReadFrom(IO& io){ return ReadFrom(io, io.BytesAvailable()); }
-        int ReadFrom(IO& io, int bytes){ return io.WriteTo(*this, bytes); }
-
-        /** Read $bytes bytes from another IO to this IO  **/
-        int WriteTo(IO& io, int bytes){
-            int buf_size = min(BUFSIZ, min(bytes, BytesAvailable()));
-            int bytes_remaining = bytes;
-            uint8_t buffer[buf_size];
-
-            while (bytes_remaining > 0 && BytesAvailable() > 0){
-                int read = ReadBytesUnlocked(buffer, min(buf_size, bytes_remaining));
-                bytes_remaining -= read;
-                io.WriteBytes(buffer, read);
-            }
-
-            return bytes;
-        }
+    /**A contiguous piece of memory. A list of slices is written in one go with IO::WriteBytesV**/
+    struct IOSlice{
+        uint8_t* ptr;
+        int nbytes;
+    };
 
-        /** Write the bytes from this IO to another IO **/
-        int WriteTo(IO& io) { return WriteTo(io, BytesAvailable()); }
+    /**The IO api (strings, printing, std serialization) written once over the primitives of Self.
+     * IO uses it with Self = IO so every primitive is a virtual call. StaticIO uses it with the concrete type so the
+     * primitives are called directly and inline**/
+    template<typename Self> struct IOApi{
+    protected:
+        inline Self& This(){ return *static_cast<Self*>(this); }
 
+    public:
         /** Write a string safely (with a length) **/
         void WriteString(const char *str) { WriteString((char *) str); }
 
@@ -107,7 +83,7 @@ namespace Simple {
         /** Write a cstring (with a null terminated char) **/
         void WriteUnsafeString(char* str){
             if (str != nullptr) {
-                WriteBytes((uint8_t*) str, strlen(str));
+                This().WriteBytes((uint8_t*) str, strlen(str));
             }else
                 WriteUnsafeString("null");
         }
@@ -120,56 +96,22 @@ namespace Simple {
         /** Write a c array to the stream with $length size **/
         template<typename T> void WriteArray(T* a, int length){
             WriteStd<uint32_t>(length);
-            WriteBytes((uint8_t*) a, length * sizeof(T));
+            This().WriteBytes((uint8_t*) a, length * sizeof(T));
         }
 
         /** Convert a Digit (value) to a Digit (char) **/
         char Dig2Char(int i) { return (i >= 0 && i <= 9) ? (char) ('0' + i) : '?'; }
 
-        /** Print a UInt64 number to the stream. The buffer should be big enough to handle all digits **/
-        void PrintUInt64(char *buffer, uint64_t l) {
-            if (l == 0) {
-                WriteByte('0');
-                return;
-            }
-            int i = 0, k = 0, hl;
-            while (l > 0) {
-                buffer[i++] = Dig2Char((int) (l % 10));
-                l /= 10;
-            }
-            //Reverse Order
-            for (hl = i / 2; k < hl; k++) {
-                int idx2 = i - k - 1;
-                char tmp = buffer[k];
-                buffer[k] = buffer[idx2];
-                buffer[idx2] = tmp;
-            }
-            buffer[i] = '\0';
-            WriteUnsafeString(buffer);
-        }
+        /** Print a UInt64 number to the stream. The buffer should hold Convert::BufferSize chars **/
+        void PrintUInt64(char *buffer, uint64_t l) { This().WriteBytes((uint8_t*) buffer, Convert::UInt64(buffer, l)); }
 
-        /** Print a Int64 number to the stream. The buffer should be big enough to handle all digits **/
-        void PrintInt64(char *buffer, int64_t l) {
-            if (l < 0) {
-                WriteByte('-');
-                l *= -1;
-            }
-            PrintUInt64(buffer, (uint64_t) l);
-        }
+        /** Print a Int64 number to the stream. The buffer should hold Convert::BufferSize chars **/
+        void PrintInt64(char *buffer, int64_t l) { This().WriteBytes((uint8_t*) buffer, Convert::Int64(buffer, l)); }
 
-        /** Print a Float64 number to the stream. The buffer should be big enough to handle all digits **/
-        void PrintFloat64(char *buffer, double d) {
-            if (d < 0) {
-                WriteByte('-');
-                d *= -1;
-            }
-            uint64_t units = floor(d);
-            PrintUInt64(buffer, units);
-            uint64_t decimals = (uint64_t) (10E3 * (d - units));
-            if (decimals > 0) {
-                WriteByte('.');
-                PrintUInt64(buffer, decimals);
-            }
+        /** Print a Float64 number to the stream with $precision digits after the point. The buffer should hold Convert::BufferSize chars
+         *  Convert::Shortest prints the shortest string that reads back to the same value (Convert::Trimmed on devices without it) **/
+        void PrintFloat64(char *buffer, double d, int precision = Convert::Shortest) {
+            This().WriteBytes((uint8_t*) buffer, Convert::Float64(buffer, d, precision));
         }
 
         /**Print to the io using the simple printf impl. The buffer should be able to handle the digits of the biggest number used
@@ -190,7 +132,7 @@ namespace Simple {
                         fmt++;
                         switch (*(fmt++)) {
                             case 'c':
-                                WriteByte((uint8_t) va_arg(sprintf_args, int));
+                                This().WriteByte((uint8_t) va_arg(sprintf_args, int));
                                 break;
                             case 'b':
                                 WriteUnsafeString(va_arg(sprintf_args, int) ? "true" : "false");
@@ -208,7 +150,7 @@ namespace Simple {
                                 PrintUInt64(buffer, va_arg(sprintf_args, unsigned long));
                                 break;
                             case 'f':
-                                PrintFloat64(buffer, va_arg(sprintf_args, double));
+                                PrintFloat64(buffer, va_arg(sprintf_args, double), Convert::Trimmed);
                                 break;
                             case 'd':
                                 PrintFloat64(buffer, va_arg(sprintf_args, double));
@@ -222,7 +164,7 @@ namespace Simple {
                             case '\0':
                                 return;
                             default:
-                                WriteByte('%');
+                                This().WriteByte('%');
                                 fmt--;
                                 break;
                         }
@@ -230,14 +172,14 @@ namespace Simple {
                     case '\0':
                         return;
                     default:
-                        WriteByte(*(fmt++));
+                        This().WriteByte(*(fmt++));
                         continue;
                 }
             }
         }
 
         void vPrintf(char *fmt, va_list list){
-            char buffer[15];    //Probaly good enough
+            char buffer[Convert::BufferSize];
             vPrintbf(buffer, fmt, list);
         }
 
@@ -257,7 +199,7 @@ namespace Simple {
             va_start(sprintf_args, fmt);
             vPrintf(fmt, sprintf_args);
             va_end(sprintf_args);
-            WriteByte('\0');
+            This().WriteByte('\0');
         }
 
 
@@ -277,7 +219,7 @@ namespace Simple {
             va_start(sprintf_args, fmt);
             vPrintf((char*) fmt, sprintf_args);
             va_end(sprintf_args);
-            WriteByte('\0');
+            This().WriteByte('\0');
         }
 
         /**Print a string to the io using the simple printf impl.
@@ -316,11 +258,19 @@ namespace Simple {
             va_end(sprintf_args);
         }
 
+        /**Print a string to the io using a compile time format made with SimpleFormat. Same conversions as Printf(char*).
+         * Each literal run is written with one WriteBytes and mismatched argument types fail to compile**/
+        template<typename F, typename... Args>
+        typename enable_if<is_base_of<FormatString, F>::value>::type Printf(F, Args... args){
+            char buffer[Convert::BufferSize];
+            Format::Writer<F, 0, Args...>::Write(This(), buffer, args...);
+        }
+
         /**Write a raw value to the stream
          * WARNING: DO NOT USE THIS FOR TYPES THAT ARE NOT PORTABLE AND SEND THEM ACROSS THE NETWORK
          * USE WriteStd at the minimum**/
         template<typename T> inline void Write(T& t){
-            WriteBytes((uint8_t*) &t, sizeof(T));
+            This().WriteBytes((uint8_t*) &t, sizeof(T));
         }
 
         /**Write a raw value to the stream
@@ -343,25 +293,14 @@ namespace Simple {
 
         /**Write a standardized value to the stream. Use this for integral types etc to send information to different devices**/
         template<typename T, bool RequiresByteSwap> void WriteStd(T* v){
-            if(RequiresByteSwap){
-                auto ptr = (uint8_t *) v;
-                std::reverse(ptr, ptr + sizeof(T));
-            }
-            WriteBytes((uint8_t*) v, sizeof(T));
+            Endian::SwapIf<RequiresByteSwap>::Value(v);
+            This().WriteBytes((uint8_t*) v, sizeof(T));
         }
 
         /**Write a standardized value to the stream. Use this for integral types etc to send information to different devices**/
         template<typename T>
         void WriteStd(T v) {
-            if (std::is_integral<T>() || std::is_floating_point<T>()) {
-                WriteStd<T,
-#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
-                        true
-#else
-                        false
-#endif
-                >(&v);
-            }else WriteStd<T, false>(&v);
+            WriteStd<T, Endian::NeedsSwap<T>::value>(&v);
         }
 
         template<std::size_t I = 0, typename... Tp> inline typename std::enable_if<I == sizeof...(Tp), void>::type WriteStd(std::tuple<Tp...> t){ }
@@ -371,17 +310,33 @@ namespace Simple {
             WriteStd<I+1, Tp...>(t);
         }
 
+        /**Write $count standardized values. Std values are swapped in bulk into a stack buffer and written with one WriteBytes per 256 bytes**/
+        template<typename T> void WriteStdArray(const T* a, int count){
+            if(!Endian::IsStd<T>::value){           //Tuples, arrays of arrays etc go through their own WriteStd
+                for(int i = 0; i < count; i++)
+                    WriteStd(a[i]);
+            }else if(!Endian::NeedsSwap<T>::value){
+                This().WriteBytes((uint8_t*) a, count * sizeof(T));
+            }else{
+                uint8_t swapped[256];
+                const int chunk = sizeof(swapped) / sizeof(T);
+                for(int i = 0; i < count; i += chunk){
+                    int n = min(chunk, count - i);
+                    Endian::ToNetwork((T*) swapped, a + i, n);
+                    This().WriteBytes(swapped, n * sizeof(T));
+                }
+            }
+        }
+
         /**Write a standardized value to the stream. Use this for integral types etc to send information to different devices**/
-        template<typename T, int S> void WriteStd(std::array<T, S>& a){
-            for(int i = 0; i < S; i++)
-                WriteStd(a[i]);
+        template<typename T, std::size_t S> void WriteStd(const std::array<T, S>& a){
+            WriteStdArray(a.data(), (int) S);
         }
 
         /**Write a standardized value to the stream. Use this for integral types etc to send information to different devices**/
-        template<typename T> void WriteStd(std::vector<T>& a){
+        template<typename T> void WriteStd(const std::vector<T>& a){
             WriteStd((uint32_t) a.size());
-            for(int i = 0; i < a.size(); i++)
-                WriteStd(a[i]);
+            WriteStdArray(a.data(), (int) a.size());
         }
 
         /**Write a standardized value to the stream. Use this for integral types etc to send information to different devices**/
@@ -389,15 +344,6 @@ namespace Simple {
             WriteStd(tuple<TArgs...>(args...));
         }
 
-        /**Read a c string from the buffer (null terminated) and return the chars read **/
-        int ReadUnsafeString(SeekableIO& buffer) { return ReadStringUntilChars(buffer, false, '\0'); }
-
-        /**Read a line from a buffer and return the chars read **/
-        int ReadLine(SeekableIO& buffer) { return ReadStringUntilChars(buffer, true, '\n', '\r'); }
-
-        /**Read a buffer until certain stop chars. Greedy means keep reading until a non stop char is found after stop char **/
-        template<typename... Chars> int ReadStringUntilChars(SeekableIO& buffer, bool greedy, Chars... stop_chars);
-
         /**Read a raw value from the stream (count)
         * WARNING: DO NOT USE THIS FOR TYPES THAT ARE NOT PORTABLE AND SEND THEM ACROSS THE NETWORK
         * USE WriteStd at the minimum**/
@@ -406,7 +352,7 @@ namespace Simple {
             auto data = (uint8_t *) t;
             int remaining = sizeof(T) * count;
             while (remaining > 0) {
-                int read = ReadBytesUnlocked(data, remaining);
+                int read = This().ReadBytesUnlocked(data, remaining);
                 remaining -= read;
                 data += read;
             }
@@ -422,37 +368,26 @@ namespace Simple {
             return t;
         }
 
-        /**Read an array from this stream to $b**/
-        template<typename T> int ReadArray(int* length, IOVector& b);
-
-        /**Read an string from this stream to $b**/
-        int ReadString(int* length, IOVector& b);
-
         /**Read a standardized value from the stream. Use this for integral types etc to send information to different devices**/
         template<typename T> void ReadStd(T *v) {
             Read(v, 1);
-            if(std::is_integral<T>() || std::is_floating_point<T>())
-                ReadStd<T,
-#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
-                        true
-#else
-                        false
-#endif
-                >(v);
+            ReadStd<T, Endian::NeedsSwap<T>::value>(v);
         }
 
-        /**Read a standardized value from the stream. Use this for integral types etc to send information to different devices**/
+        /**Read $count standardized values from the stream. They are read with one copy and swapped in place in one pass**/
         template<typename T> void ReadStd(T* v, int count){
-            for(int i = 0; i < count; i++)
-                ReadStd<T>(v + i);
+            if(!Endian::IsStd<T>::value){
+                for(int i = 0; i < count; i++)
+                    ReadStd<T>(v + i);
+                return;
+            }
+            Read(v, count);
+            Endian::FromNetwork(v, v, count);
         }
 
         /**Read a standardized value from the stream. Use this for integral types etc to send information to different devices**/
         template<typename T, bool RequiresByteSwap> void ReadStd(T* v){
-            if(RequiresByteSwap){
-                auto ptr = (uint8_t *) v;
-                std::reverse(ptr, ptr + sizeof(T));
-            }
+            Endian::SwapIf<RequiresByteSwap>::Value(v);
         }
 
         /**Read a standardized value from the stream. Use this for integral types etc to send information to different devices**/
@@ -472,17 +407,15 @@ namespace Simple {
         }
 
         /**Read a standardized array from the stream. Use this for integral types etc to send information to different devices**/
-        template<typename T, int S> void ReadStd(std::array<T, S>* a){
-            for(int i = 0; i < S; i++)
-                ReadStd<T>(&(*a)[i]);
+        template<typename T, std::size_t S> void ReadStd(std::array<T, S>* a){
+            ReadStd(a->data(), (int) S);
         }
 
         /**Read a standardized vector from the stream. Use this for integral types etc to send information to different devices**/
         template<typename T> void ReadStd(std::vector<T>* a){
             auto s = ReadStd<uint32_t>();
             a->resize(s);
-            for(int i = 0; i < s; i++)
-                ReadStd<T>(&(*a)[i]);
+            ReadStd(a->data(), (int) s);
         }
 
         /**Read a standardized value from the stream. Use this for integral types etc to send information to different devices**/
@@ -492,7 +425,7 @@ namespace Simple {
 
         /**Try to read a value from IO. Return if it could or not **/
         template<typename T> inline bool TryRead(T* t, int count = 1){
-            if(BytesAvailable() >= sizeof(T) * count){
+            if(This().BytesAvailable() >= sizeof(T) * count){
                 Read<T>(t, count);
                 return true;
             }else return false;
@@ -500,7 +433,7 @@ namespace Simple {
 
         /**Try to read a std value from IO. Return if it could or not **/
         template<typename T> inline bool TryReadStd(T* t, int count = 1){
-            if(BytesAvailable() >= sizeof(T) * count){
+            if(This().BytesAvailable() >= sizeof(T) * count){
                 ReadStd(t, count);
                 return true;
             }else return false;
@@ -515,6 +448,99 @@ namespace Simple {
         }
     };
 
+    /**Base Implementation of a stream. Is a wrapper over ports
+     **/
+    struct IO : public IOApi<IO> {
+        /** Return the number of bytes that are in the stream that can be read **/
+        virtual int BytesAvailable() = 0;
+
+        /** Read bytes from the stream to a buffer without blocking. Return the bytes written **/
+        virtual int ReadBytesUnlocked(uint8_t *ptr, int buffer_size) = 0;
+
+        /** Write the bytes from this IO to another IO **/
+        virtual int WriteBytes(uint8_t *ptr, int nbytes) = 0;
+
+        /** Write several slices to the stream back to back (scatter/gather). Return the bytes written.
+         *  Implementations should override this if the port can take the slices without gathering them first **/
+        virtual int WriteBytesV(IOSlice* slices, int count){
+            int written = 0;
+            for(int i = 0; i < count; i++)
+                written += WriteBytes(slices[i].ptr, slices[i].nbytes);
+            return written;
+        }
+
+        /** Write a byte to the stream **/
+        virtual int WriteByte(uint8_t b){ return WriteBytes(&b, 1); }
+
+        /** Read a byte from the stream. Return -1 if there is none **/
+        virtual int ReadByte(){ uint8_t b; return ReadBytesUnlocked(&b, 1) == 1 ? b : -1; }
+
+        /** Push anything held back by the stream out to the port **/
+        virtual void Flush(){}
+
+        /** Read from another IO to this IO **/
+        int ReadFrom(IO& io){ return ReadFrom(io, io.BytesAvailable()); }
+        int ReadFrom(IO& io, int bytes){ return io.WriteTo(*this, bytes); }
+
+        /** Read $bytes bytes from another IO to this IO  **/
+        int WriteTo(IO& io, int bytes){
+            int buf_size = min(BUFSIZ, min(bytes, BytesAvailable()));
+            int bytes_remaining = bytes;
+            uint8_t buffer[buf_size];
+
+            while (bytes_remaining > 0 && BytesAvailable() > 0){
+                int read = ReadBytesUnlocked(buffer, min(buf_size, bytes_remaining));
+                bytes_remaining -= read;
+                io.WriteBytes(buffer, read);
+            }
+
+            return bytes;
+        }
+
+        /** Write the bytes from this IO to another IO **/
+        int WriteTo(IO& io) { return WriteTo(io, BytesAvailable()); }
+
+        /**Read a c string from the buffer (null terminated) and return the chars read **/
+        int ReadUnsafeString(SeekableIO& buffer) { return ReadStringUntilChars(buffer, false, '\0'); }
+
+        /**Read a line from a buffer and return the chars read **/
+        int ReadLine(SeekableIO& buffer) { return ReadStringUntilChars(buffer, true, '\n', '\r'); }
+
+        /**Read a buffer until certain stop chars. Greedy means keep reading until a non stop char is found after stop char **/
+        template<typename... Chars> int ReadStringUntilChars(SeekableIO& buffer, bool greedy, Chars... stop_chars);
+
+        /**Read an array from this stream to $b**/
+        template<typename T> int ReadArray(int* length, IOVector& b);
+
+        /**Read an string from this stream to $b**/
+        int ReadString(int* length, IOVector& b);
+    };
+
+    /**Gives Derived the IO api with its own primitives called directly instead of through the vtable, while it is still
+     * usable as a plain IO. Derived should mark its primitives final. Use it like this
+     *  struct IOArray : public StaticIO<IOArray, SeekableIO>{ ... }; **/
+    template<typename Derived, typename Base = IO> struct StaticIO : public Base, public IOApi<Derived>{
+        using Base::Base;
+        using IOApi<Derived>::WriteString;
+        using IOApi<Derived>::WriteUnsafeString;
+        using IOApi<Derived>::WriteArray;
+        using IOApi<Derived>::Dig2Char;
+        using IOApi<Derived>::PrintUInt64;
+        using IOApi<Derived>::PrintInt64;
+        using IOApi<Derived>::PrintFloat64;
+        using IOApi<Derived>::vPrintbf;
+        using IOApi<Derived>::vPrintf;
+        using IOApi<Derived>::PrintfEnd;
+        using IOApi<Derived>::Printf;
+        using IOApi<Derived>::Write;
+        using IOApi<Derived>::WriteStd;
+        using IOApi<Derived>::WriteStdArray;
+        using IOApi<Derived>::Read;
+        using IOApi<Derived>::ReadStd;
+        using IOApi<Derived>::TryRead;
+        using IOApi<Derived>::TryReadStd;
+    };
+
     /**Simple Implementation of a in memory buffer from the IO
    **/
     struct SeekableIO : public IO{
@@ -528,7 +554,7 @@ namespace Simple {
         int BytesAvailable() final { return Size() - Position(); }
     };
 
-    class IOVector : public SeekableIO {
+    class IOVector : public StaticIO<IOVector, SeekableIO> {
         size_t position = 0, max_size = 0;
         std::vector<uint8_t> memory;
     public:
@@ -539,7 +565,7 @@ namespace Simple {
         size_t Size() final { return memory.size(); }
         void Seek(size_t pos) final { position = pos; }
 
-        int WriteByte(uint8_t c) {
+        int WriteByte(uint8_t c) final {
             if (memory.size() + 1 > max_size)
                 return 0;
             if (position >= memory.size()){
@@ -551,7 +577,7 @@ namespace Simple {
             return 1;
         }
 
-        int WriteBytes(uint8_t *ptr, int nbytes) override{
+        int WriteBytes(uint8_t *ptr, int nbytes) final {
             if(nbytes == 1)
                 return ptr != nullptr ? WriteByte(*(uint8_t*) ptr) : WriteByte(0);
             else if(nbytes > 0){
@@ -569,9 +595,9 @@ namespace Simple {
             return 0;
         }
 
-        int ReadByte() { return memory[position++]; }
+        int ReadByte() final { return position < memory.size() ? memory[position++] : -1; }
 
-        int ReadBytesUnlocked(uint8_t *ptr, int buffer_size) override{
+        int ReadBytesUnlocked(uint8_t *ptr, int buffer_size) final {
             if(buffer_size == 1 && BytesAvailable() > 0){
                 *ptr = ReadByte();
                 return 1;
@@ -625,10 +651,14 @@ namespace Simple {
         void InsertRange(size_t start, int length){ memory.insert(memory.begin() + start, length, 0); }
     };
 
-    struct IOArray : public SeekableIO{
+    /**In memory buffer with optional headroom in front of the data and tailroom behind it.
+     * Headers and trailers can be added (Prepend/Append) or stripped (Strip) by moving the start and end offsets
+     * instead of shifting the data, in the style of kernel socket buffers**/
+    struct IOArray : public StaticIO<IOArray, SeekableIO>{
     private:
         ref<uint8_t> memory;
-        size_t position, size, capacity;
+        Allocator* from = &Heap;            //Where the memory (and a bigger one when it grows) comes from
+        size_t position, size, capacity, head, headroom, tailroom;
 
         void WriteSize(int length){
             auto pl = position + length;
@@ -636,42 +666,59 @@ namespace Simple {
                 size = pl;
         }
 
+        inline uint8_t* Data() { return memory.get() + head; }
+
     public:
+        /**Saved window of the array. Used to temporarily narrow the array and restore it afterwards**/
+        struct Mark{ size_t head, position, size; };
+
         void Seek(size_t pos) final { position = pos; }
 
         size_t Position() final { return position; }
-        uint8_t* Begin() { return memory.get() + position; }
-        uint8_t* End() { return memory.get() + size; }
+        uint8_t* Begin() { return Data() + position; }
+        uint8_t* End() { return Data() + size; }
         size_t Size() final { return size; }
-        inline size_t Capacity() const { return capacity; }
-
-        explicit IOArray(int capacity = BUFSIZ) : memory(new uint8_t[capacity]), capacity(capacity), size(0), position(0){}
-        IOArray(ref<uint8_t> heap_ref, int capacity, int size = 0) : memory(std::move(heap_ref)), capacity(capacity), size(size), position(0){}
+        /**Bytes the data can be written up to. The reserved tailroom is not part of it**/
+        inline size_t Capacity() const { return capacity - head - tailroom; }
+        inline size_t Headroom() const { return head; }
+        /**Bytes Append can add behind the data, the reserved tailroom included**/
+        inline size_t Tailroom() const { return capacity - head - size; }
+
+        explicit IOArray(int capacity = BUFSIZ, int headroom = 0, int tailroom = 0) : IOArray(Heap, capacity, headroom, tailroom){}
+        /**Array in memory from $from (a Pool or Arena). It has no capacity when $from is out of memory.
+         * The last $tailroom bytes are kept for Append, writes stop in front of them**/
+        IOArray(Allocator& from, int capacity, int headroom = 0, int tailroom = 0) : memory(AllocateRef(from, capacity + headroom + tailroom)), from(&from),
+                                                                   capacity(capacity + headroom + tailroom), size(0), position(0), head(headroom), headroom(headroom), tailroom(tailroom){
+            if(!memory)
+                this->capacity = head = this->headroom = this->tailroom = 0;
+        }
+        IOArray(ref<uint8_t> heap_ref, int capacity, int size = 0) : memory(std::move(heap_ref)), capacity(capacity), size(size), position(0),
+                                                                   head(0), headroom(0), tailroom(0){}
 
-        int WriteByte(uint8_t c) {
-            if(capacity > position){
+        int WriteByte(uint8_t c) final {
+            if(Capacity() > position){
                 WriteSize(1);
-                memory.get()[position++] = c;
+                Data()[position++] = c;
                 return true;
             }
             return false;
         }
 
-        int WriteBytes(uint8_t *ptr, int nbytes) override{
+        int WriteBytes(uint8_t *ptr, int nbytes) final {
             if(nbytes == 1)
                 return WriteByte(*ptr);
-            if(nbytes > 1 && position + nbytes <= capacity){
+            if(nbytes > 1 && position + nbytes <= Capacity()){
                 memmove(Begin(), ptr, nbytes);
                 WriteSize(nbytes);
                 position += nbytes;
-                return true;
+                return nbytes;
             }
-            return false;
+            return 0;
         }
 
-        int ReadByte() { return memory.get()[position++]; }
+        int ReadByte() final { return position < size ? Data()[position++] : -1; }
 
-        int ReadBytesUnlocked(uint8_t *ptr, int buffer_size) override{
+        int ReadBytesUnlocked(uint8_t *ptr, int buffer_size) final {
             auto ba = BytesAvailable();
 
             if(ba > 0){
@@ -689,13 +736,19 @@ namespace Simple {
             return 0;
         }
 
-        void Reserve(size_t s) {
-            if(s > capacity){
-                auto p = new uint8_t[s];
-                memcpy(p, memory.get(), size);
-                memory.reset(p, RefDeleter<uint8_t>(true));
-                capacity = s;
+        /**Make sure $s bytes fit after the start of the data. The bigger memory comes from the same allocator.
+         * Return false when it is out of memory, the data is left as it was**/
+        bool Reserve(size_t s) {
+            if(s > Capacity()){
+                auto p = AllocateRef(*from, head + s + tailroom);
+                if(!p)
+                    return false;
+                if(memory)
+                    memcpy(p.get(), memory.get(), head + size);
+                memory = std::move(p);
+                capacity = head + s + tailroom;
             }
+            return true;
         }
 
         void SetBytesAvailable(size_t s, bool adjMemory = false){
@@ -703,24 +756,62 @@ namespace Simple {
         }
 
         void SetSize(size_t s, bool adjMemory = false){
-            if(adjMemory && s > capacity){
-                Reserve(s);
-            }
+            if(adjMemory && s > Capacity() && !Reserve(s))
+                s = Capacity();
             size = s;
         }
 
+        /**Grow the data by $n bytes at the front and return a pointer to them. The position keeps pointing at the same byte.
+         * Costs nothing when there is enough headroom, otherwise the data is shifted into the tailroom. Returns nullptr when it is out of memory**/
+        uint8_t* Prepend(size_t n){
+            if(head >= n){
+                head -= n;
+                size += n;
+                position += n;
+            }else{
+                if(!Reserve(size + n))
+                    return nullptr;
+                InsertRange(0, n);
+                position += n;
+            }
+            return Data();
+        }
+
+        /**Grow the data by $n bytes at the back and return a pointer to them. Returns nullptr when there is no tailroom left**/
+        uint8_t* Append(size_t n){
+            if(Tailroom() < n)
+                return nullptr;
+            auto tail = End();
+            size += n;
+            return tail;
+        }
+
+        /**Drop $n bytes from the front of the data by advancing the start**/
+        void Strip(size_t n){
+            n = min(n, size);
+            head += n;
+            size -= n;
+            position = position > n ? position - n : 0;
+        }
+
+        inline Mark Save() const { return {head, position, size}; }
+        inline void Restore(const Mark& m){ head = m.head; position = m.position; size = m.size; }
+
         /**Read the raw memory of the io at the current position**/
-        template<typename T = uint8_t> T* Interpret(size_t pos){ return (T*) &memory.get()[pos]; }
+        template<typename T = uint8_t> T* Interpret(size_t pos){ return (T*) &Data()[pos]; }
         /**Read the raw memory of the io at the specified position **/
-        template<typename T = uint8_t> T* Interpret(){ return (T*) &memory.get()[position]; }
+        template<typename T = uint8_t> T* Interpret(){ return (T*) &Data()[position]; }
 
         void Clear(){
             position = 0;
             size = 0;
+            head = headroom;
         }
 
         void ClearToPosition(){
-            if(position != 0){
+            if(position == size){
+                Clear();
+            }else if(position != 0){
                 RemoveRange(0, position);
                 position = 0;
             }
@@ -730,8 +821,8 @@ namespace Simple {
             io.WriteByte('[');
             for(auto i = position; i < size; i++){
                 if(i != position)
-                    io.Printf(", %i", memory.get()[i]);
-                else io.Printf("%i", memory.get()[i]);
+                    io.Printf(", %i", Data()[i]);
+                else io.Printf("%i", Data()[i]);
             }
             io.Printf(": Size=%i, Position=%i, Capacity=%i]\n\r", Size(), Position(), Capacity());
         }
@@ -745,7 +836,7 @@ namespace Simple {
             start = max((size_t) 0, start);
             auto end = start + length;
 
-            memmove(memory.get() + start, memory.get() + end, size - end);        //Move the end to this location
+            memmove(Data() + start, Data() + end, size - end);        //Move the end to this location
 
             size -= length;
         }
@@ -754,12 +845,120 @@ namespace Simple {
             start = max((size_t) 0, start);
             auto end = start + length;
 
-            memmove(memory.get() + end, memory.get() + start, size - start);         //Move the end to this location
+            memmove(Data() + end, Data() + start, size - start);         //Move the end to this location
 
             size += length;
         }
     };
 
+    /**Lock free single producer / single consumer ring buffer. One side (like an interrupt) can write while the other
+     * side reads without any locking. The capacity is rounded up to a power of two so indices wrap with a mask.
+     * The reader side is seekable: Position() is how far the reader has read past the oldest byte and nothing is
+     * given back to the producer until it is committed (Commit / ClearToPosition)**/
+    struct IORing : public StaticIO<IORing, SeekableIO>{
+    private:
+        ref<uint8_t> memory;
+        size_t mask, position = 0;
+        std::atomic<size_t> head, tail;     //Free running. Written by the producer / consumer only
+
+        static size_t RoundCapacity(size_t capacity){
+            size_t c = 1;
+            while(c < capacity)
+                c <<= 1;
+            return c;
+        }
+
+    public:
+        explicit IORing(size_t capacity = 256) : memory(AllocateRef(Heap, RoundCapacity(capacity))), mask(RoundCapacity(capacity) - 1), head(0), tail(0){}
+
+        /**Use $capacity bytes of $heap_ref as the ring. $capacity must be a power of two**/
+        IORing(ref<uint8_t> heap_ref, size_t capacity) : memory(std::move(heap_ref)), mask(capacity - 1), head(0), tail(0){}
+
+        inline size_t Capacity() const { return mask + 1; }
+        inline ref<uint8_t>& Memory() { return memory; }
+
+        /*--------------------------------------Producer--------------------------------------*/
+
+        /**Bytes the producer can still write**/
+        inline size_t Free() { return Capacity() - (head.load(memory_order_relaxed) - tail.load(memory_order_acquire)); }
+
+        /**Get the contiguous free space at the head of the ring. Fill it and then Produce the bytes written**/
+        size_t WriteSpan(uint8_t** ptr){
+            auto h = head.load(memory_order_relaxed);
+            *ptr = memory.get() + (h & mask);
+            return min(Free(), Capacity() - (h & mask));
+        }
+
+        /**Publish $n bytes written to the WriteSpan to the consumer**/
+        inline void Produce(size_t n){ head.store(head.load(memory_order_relaxed) + n, memory_order_release); }
+
+        int WriteByte(uint8_t c) final {
+            auto h = head.load(memory_order_relaxed);
+            if(h - tail.load(memory_order_acquire) == Capacity())
+                return 0;
+            memory.get()[h & mask] = c;
+            head.store(h + 1, memory_order_release);
+            return 1;
+        }
+
+        int WriteBytes(uint8_t *ptr, int nbytes) final {
+            int written = 0;
+            uint8_t* span;
+            size_t n;
+            while(written < nbytes && (n = WriteSpan(&span)) > 0){
+                n = min(n, (size_t) (nbytes - written));
+                memcpy(span, ptr + written, n);
+                Produce(n);
+                written += n;
+            }
+            return written;
+        }
+
+        /*--------------------------------------Consumer--------------------------------------*/
+
+        size_t Size() final { return head.load(memory_order_acquire) - tail.load(memory_order_relaxed); }
+        size_t Position() final { return position; }
+        void Seek(size_t pos) final { position = pos; }
+
+        /**Get the contiguous readable bytes at the current position without consuming them**/
+        size_t Peek(uint8_t** ptr){
+            auto t = tail.load(memory_order_relaxed) + position;
+            *ptr = memory.get() + (t & mask);
+            return min((size_t) max(BytesAvailable(), 0), Capacity() - (t & mask));
+        }
+
+        /**Give $n bytes from the oldest byte back to the producer**/
+        void Commit(size_t n){
+            n = min(n, Size());
+            tail.store(tail.load(memory_order_relaxed) + n, memory_order_release);
+            position = position > n ? position - n : 0;
+        }
+
+        inline void ClearToPosition(){ Commit(position); }
+        inline void Clear(){ Commit(Size()); }
+
+        int ReadByte() final {
+            uint8_t* ptr;
+            if(Peek(&ptr) == 0)
+                return -1;
+            position++;
+            return *ptr;
+        }
+
+        int ReadBytesUnlocked(uint8_t *ptr, int buffer_size) final {
+            int read = 0;
+            uint8_t* span;
+            size_t n;
+            while(read < buffer_size && (n = Peek(&span)) > 0){
+                n = min(n, (size_t) (buffer_size - read));
+                memcpy(ptr + read, span, n);
+                position += n;
+                read += n;
+            }
+            return read;
+        }
+    };
+
     template<typename... Chars>
     int IO::ReadStringUntilChars(Simple::SeekableIO& buffer, bool greedy, Chars ...stop_chars) {
         uint8_t c;
@@ -799,39 +998,177 @@ namespace Simple {
         return pos;
     }
 
+    /**Read only IO over a list of slices. Lets a scatter/gather write be consumed by anything that reads an IO**/
+    struct SliceIO : public StaticIO<SliceIO>{
+        IOSlice* slices;
+        int count, index = 0, offset = 0;
+
+        SliceIO(IOSlice* slices, int count) : slices(slices), count(count){}
+
+        int BytesAvailable() final {
+            int available = 0;
+            for(int i = index; i < count; i++)
+                available += slices[i].nbytes;
+            return available - offset;
+        }
+
+        int ReadBytesUnlocked(uint8_t *ptr, int buffer_size) final {
+            int read = 0;
+            while(read < buffer_size && index < count){
+                auto n = min(buffer_size - read, slices[index].nbytes - offset);
+                memcpy(ptr + read, slices[index].ptr + offset, n);
+                read += n;
+                offset += n;
+                if(offset == slices[index].nbytes){
+                    index++;
+                    offset = 0;
+                }
+            }
+            return read;
+        }
+
+        int WriteBytes(uint8_t *ptr, int nbytes) final { return 0; }
+    };
+
     /**Implementation of the IO to a FILE***/
-    struct FileIO : public IO{
+    struct FileIO : public StaticIO<FileIO>{
         FILE* out, *in;
 
         FileIO(FILE* out, FILE* in) : out(out), in(in){}
-        int WriteByte(uint8_t c){ return putc(c, out) == EOF ? 0 : 1; }
-        int WriteBytes(uint8_t *ptr, int nbytes) final { return fwrite(ptr, nbytes, 1, out); }
-        int ReadByte() { return getc(in); }
+        int WriteByte(uint8_t c) final { return putc(c, out) == EOF ? 0 : 1; }
+        int WriteBytes(uint8_t *ptr, int nbytes) final { return fwrite(ptr, 1, nbytes, out); }
+        int WriteBytesV(IOSlice* slices, int count) final {
+            int written = 0;
+            for(int i = 0; i < count; i++)
+                written += fwrite(slices[i].ptr, 1, slices[i].nbytes, out);     //Gathered by the FILE buffer
+            return written;
+        }
+        int ReadByte() final { return getc(in); }
         int ReadBytesUnlocked(uint8_t *ptr, int buffer_size) final { return fread(ptr, 1, buffer_size, in); }
-        int BytesAvailable() final { return feof(out) ? 1 : 0; }
+        int BytesAvailable() final { return in != nullptr ? NativeBytesAvailable(in) : 0; }
+        void Flush() final { fflush(out); }
+    };
+
+    /**When a BufferedIO pushes its buffer to the port. It always does when the buffer is full or Flush is called**/
+    enum FlushPolicy : uint8_t{
+        FlushOnFull = 0,
+        FlushOnNewline = 1,         //After any write holding a '\n'
+        FlushOnYield = 2            //After every Task::Yield pass, so a partial line does not sit in the buffer
+    };
+
+    /**Collects the small writes of Printf and friends and hands them to another IO in one WriteBytes.
+     * Reads pass straight through, flushing first so a prompt is out before waiting on the answer. Use it like this
+     *  BufferedIO out(serial, 64, FlushOnNewline | FlushOnYield); **/
+    struct BufferedIO : public StaticIO<BufferedIO>{
+        IO& io;
+        ref<uint8_t> buffer;
+        int capacity, count = 0;
+        uint8_t policy;
+
+        explicit BufferedIO(IO& io, int capacity = 64, uint8_t policy = FlushOnNewline) :
+            io(io), buffer(AllocateRef(Heap, capacity)), capacity(capacity), policy(policy){
+            if(policy & FlushOnYield){
+                next_yielded = Yielded();
+                Yielded() = this;
+            }
+        }
+
+        BufferedIO(const BufferedIO&) = delete;
+        ~BufferedIO(){
+            Flush();
+            for(auto b = &Yielded(); *b != nullptr; b = &(*b)->next_yielded)
+                if(*b == this){
+                    *b = next_yielded;
+                    break;
+                }
+        }
+
+        /**Flush every FlushOnYield buffer holding something. Task::Yield calls it after each pass**/
+        static void FlushYielded(){
+            for(auto b = Yielded(); b != nullptr; b = b->next_yielded)
+                if(b->count > 0)
+                    b->Flush();
+        }
+
+        /**Bytes waiting in the buffer**/
+        int Pending(){ return count; }
+
+        void Flush() final {
+            if(count > 0){
+                io.WriteBytes(buffer.get(), count);
+                count = 0;
+            }
+            io.Flush();
+        }
+
+        int WriteByte(uint8_t c) final {
+            if(count == capacity)
+                Flush();
+            buffer.get()[count++] = c;
+            if(count == capacity || (c == '\n' && (policy & FlushOnNewline)))
+                Flush();
+            return 1;
+        }
+
+        int WriteBytes(uint8_t *ptr, int nbytes) final {
+            if(nbytes >= capacity){
+                Flush();                                    //Too big to gain anything from the copy
+                io.WriteBytes(ptr, nbytes);
+                if(policy & FlushOnNewline)
+                    io.Flush();
+                return nbytes;
+            }
+            if(count + nbytes > capacity)
+                Flush();
+            memcpy(buffer.get() + count, ptr, nbytes);
+            count += nbytes;
+            if(count == capacity || ((policy & FlushOnNewline) && memchr(ptr, '\n', nbytes) != nullptr))
+                Flush();
+            return nbytes;
+        }
+
+        int WriteBytesV(IOSlice* slices, int n) final {
+            int written = 0;
+            for(int i = 0; i < n; i++)
+                written += WriteBytes(slices[i].ptr, slices[i].nbytes);
+            return written;
+        }
+
+        int ReadByte() final {
+            if(count > 0)
+                Flush();
+            return io.ReadByte();
+        }
+
+        int ReadBytesUnlocked(uint8_t *ptr, int buffer_size) final {
+            if(count > 0)
+                Flush();
+            return io.ReadBytesUnlocked(ptr, buffer_size);
+        }
+
+        int BytesAvailable() final { return io.BytesAvailable(); }
+
+    private:
+        BufferedIO* next_yielded = nullptr;
+
+        /**Head of the FlushOnYield buffers. A function static so a global BufferedIO can join it during static init**/
+        static BufferedIO*& Yielded(){
+            static BufferedIO* head = nullptr;
+            return head;
+        }
     };
 
 
-    /**Check the endianness of the system to see if it is correct or not**/
+    /**Check the endianness of the system matches the byte order the library was compiled for (__BYTE_ORDER__) and set up
+     * the device's standard streams. Call it at the start of main, before anything is read**/
     static bool InitializeIO(){
+        NativeInitializeIO();
         uint16_t v = 0xdeef;
         auto lead = *(uint8_t*) &v;
         auto machine_endian_type =  lead == 0xef ? Endianness::LITTLE :
                                     lead == 0xde ? Endianness::BIG    :
                                     Endianness::Unknown;
-        if(Endianness::Unknown == machine_endian_type){
-            return false;
-        }
-        else if(Endianness::BIG == machine_endian_type){
-#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
-            return false;
-#endif
-        }else{
-#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
-            return false;
-#endif
-        }
-        return true;
+        return machine_endian_type == (Endian::NetworkSwap ? Endianness::LITTLE : Endianness::BIG);
     }
 }
 
@@ -17,6 +17,8 @@
 #define SIMPLE_LAMBDA_C_H
 
 #include <tuple>
+#include <new>
+#include <cstddef>
 #include "SimpleLoop.hpp"
 #include "SimpleMemory.hpp"
 
@@ -69,6 +71,93 @@ namespace Simple{
         }
     };
 
+#ifndef SIMPLE_LAMBDA_SIZE
+    #define SIMPLE_LAMBDA_SIZE (4 * sizeof(void*))      //Bytes of captures an InlineLambda holds by default
+#endif
+
+    /**Move only lambda that keeps its captures inline. It never allocates and cannot be copied so there is no
+     * reference count either. Captures bigger than $Size fail to compile, Spill keeps them in memory from the allocator it is given.
+     * Use it like this
+     *  InlineLambda<void(Timer&)> callback = [&count](Timer&){ count++; }; **/
+    template<typename TFun, int Size = SIMPLE_LAMBDA_SIZE> struct InlineLambda;
+
+    template<typename TRet, typename ...TArgs, int Size>
+    struct InlineLambda<TRet (TArgs...), Size>{
+        InlineLambda(){}
+        InlineLambda(nullptr_t){}
+
+        template<typename F, typename = typename enable_if<!is_same<typename decay<F>::type, InlineLambda>::value>::type>
+        InlineLambda(F f){
+            static_assert(sizeof(F) <= Size, "Lambda captures do not fit. Raise the size or Spill them");
+            static_assert(alignof(F) <= alignof(max_align_t), "Lambda captures are over aligned");
+            new (storage) F(std::move(f));
+            call = [](void* lam, TArgs... args) -> TRet { return (*(F*) lam)(std::forward<TArgs>(args)...); };
+            manage = [](void* dst, void* src){
+                if(dst != nullptr)
+                    new (dst) F(std::move(*(F*) src));
+                ((F*) src)->~F();
+            };
+        }
+
+        InlineLambda(InlineLambda&& o){ Take(o); }
+        InlineLambda(const InlineLambda&) = delete;
+        ~InlineLambda(){ Reset(); }
+
+        InlineLambda& operator=(InlineLambda&& o){
+            if(this != &o){
+                Reset();
+                Take(o);
+            }
+            return *this;
+        }
+
+        /**Keep captures that do not fit in memory from $from (Heap, a Pool or an Arena). Empty when it is out of memory**/
+        template<typename F> static InlineLambda Spill(F f, Allocator& from){
+            struct Boxed{
+                F* f;
+                Allocator* from;
+
+                Boxed(F* f, Allocator* from) : f(f), from(from){}
+                Boxed(Boxed&& o) : f(o.f), from(o.from){ o.f = nullptr; }
+                ~Boxed(){
+                    if(f == nullptr)
+                        return;
+                    f->~F();
+                    from->Free(f);
+                }
+                TRet operator()(TArgs... args){ return (*f)(std::forward<TArgs>(args)...); }
+            };
+            auto p = from.Allocate(sizeof(F));
+            if(p == nullptr)
+                return InlineLambda();
+            return InlineLambda(Boxed(new (p) F(std::move(f)), &from));
+        }
+
+        void Reset(){
+            if(manage != nullptr)
+                manage(nullptr, storage);
+            call = nullptr;
+            manage = nullptr;
+        }
+
+        explicit operator bool() const { return call != nullptr; }
+        inline TRet operator ()(TArgs... args){ return call(storage, std::forward<TArgs>(args)...); }
+
+    private:
+        Function<TRet, void*, TArgs...> call = nullptr;
+        void (*manage)(void* dst, void* src) = nullptr;        //Move the captures to $dst (if set) and destroy them in $src
+        alignas(max_align_t) uint8_t storage[Size];
+
+        void Take(InlineLambda& o){
+            if(o.manage != nullptr)
+                o.manage(storage, o.storage);
+            call = o.call;
+            manage = o.manage;
+            o.call = nullptr;
+            o.manage = nullptr;
+        }
+    };
+
     /**Create a statically allocated lambda.**/
     template<typename TRet, typename ...TArgs> inline Lambda<TRet (TArgs...)> StaticLambda(TRet (*f)(TArgs...)){
         using TF = TRet (*)(TArgs...);
@@ -91,6 +180,12 @@ namespace Simple{
     /**Create a globally allocated lambda. Its auto freed when your done :)**/
     template<typename TFun, typename F> inline Lambda<TFun> GlobalLambda(F lambda){ return GlobalLambda<TFun>(&lambda); }
 
+    /**Create a lambda with its captures in memory from $from (a Pool or Arena). Check it is set before calling it, it is empty when $from is out of memory**/
+    template<typename TFun, typename F> inline Lambda<TFun> GlobalLambda(F lambda, Allocator& from){
+        auto l = MakeRef<F>(from, std::move(lambda));
+        return l ? Lambda<TFun>::make_lambda(l) : Lambda<TFun>();
+    }
+
     /**Apply a tuple to a lambda to invoke it**/
     template<typename RT, typename ...Args> inline RT apply(Lambda<RT (Args...)>& l, std::tuple<Args...> t) {
         return apply(l, t, typename gens<sizeof...(Args)>::type());
@@ -7,45 +7,192 @@
 		Medium Level (from Low) library that abstracts away from embedded device hardware
 
     Simple Lock
-		Provide Multithreading support
+		Provide Multithreading support. Spin and ticket locks for threads on the PC, and a lock that masks
+		interrupts for sharing data with an interrupt on a single core board. Each counts how often it was taken
+		and how often it had to wait
 *********************************************************************/
 
 #ifndef Simple_Lock_C_H
 #define Simple_Lock_C_H
 
 #include "SimpleCore.hpp"
+#include "SimpleMemory.hpp"
+#include <atomic>
+#include <new>
+
+namespace Simple{
+    /**Give the cpu to whoever holds a lock. Defined by the device backend**/
+    static void NativeSpinWait();
+
+    /**Spin once while waiting on a lock. Every so often the thread steps aside in case the holder needs the core**/
+    inline void SpinRelax(uint32_t spins){
+        if(spins % 64 == 63){
+            NativeSpinWait();
+            return;
+        }
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__) || (defined(__ARM_ARCH) && __ARM_ARCH >= 7)
+        __asm__ volatile("yield");
+#endif
+    }
+
+    /**Takes a lock for as long as it is in scope. Use it like this
+     *  Guard<SpinLock> g(lock); **/
+    template<typename L> struct Guard{
+        L& lock;
+
+        explicit Guard(L& lock) : lock(lock){ lock.Lock(); }
+        Guard(const Guard&) = delete;
+        ~Guard(){ lock.Unlock(); }
+    };
+
+    /**Test and test and set spinlock. Waiters spin on a plain load, so the cache line is only fought over when it is
+     * let go. Not fair. Do not use it between the loop and an interrupt on one core, use InterruptLock**/
+    struct SpinLock{
+        SpinLock(){}
+        SpinLock(const SpinLock&) = delete;
+
+        void Lock(){
+            uint32_t spins = 0;
+            while(locked.exchange(true, std::memory_order_acquire))
+                while(locked.load(std::memory_order_relaxed))
+                    SpinRelax(spins++);
+            acquired++;                     //Counted while held so they need no atomics
+            if(spins > 0)
+                contended++;
+        }
+
+        bool TryLock(){
+            if(locked.load(std::memory_order_relaxed) || locked.exchange(true, std::memory_order_acquire))
+                return false;
+            acquired++;
+            return true;
+        }
+
+        inline void Unlock(){ locked.store(false, std::memory_order_release); }
+        inline bool IsLocked() const { return locked.load(std::memory_order_relaxed); }
+
+        inline uint32_t Acquired() const { return acquired; }
+        inline uint32_t Contended() const { return contended; }      //Times Lock had to wait
+        void ResetCounters(){ acquired = contended = 0; }
+
+    private:
+        std::atomic<bool> locked{false};
+        uint32_t acquired = 0, contended = 0;
+    };
+
+    /**Spinlock that hands the lock out in the order it was asked for, so no thread starves. Each waiter spins on the
+     * ticket being served. Slower than SpinLock when there are more threads than cores**/
+    struct TicketLock{
+        TicketLock(){}
+        TicketLock(const TicketLock&) = delete;
+
+        void Lock(){
+            auto ticket = next.fetch_add(1, std::memory_order_relaxed);
+            uint32_t spins = 0;
+            while(serving.load(std::memory_order_acquire) != ticket)
+                SpinRelax(spins++);
+            acquired++;
+            if(spins > 0)
+                contended++;
+        }
+
+        bool TryLock(){
+            auto ticket = serving.load(std::memory_order_relaxed);
+            auto expected = ticket;
+            if(!next.compare_exchange_strong(expected, ticket + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                return false;
+            acquired++;
+            return true;
+        }
+
+        inline void Unlock(){ serving.store(serving.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+        inline bool IsLocked() const { return next.load(std::memory_order_relaxed) != serving.load(std::memory_order_relaxed); }
+
+        /**Threads holding or waiting on the lock**/
+        inline uint32_t Waiting() const { return next.load(std::memory_order_relaxed) - serving.load(std::memory_order_relaxed); }
+
+        inline uint32_t Acquired() const { return acquired; }
+        inline uint32_t Contended() const { return contended; }      //Times Lock had to wait
+        void ResetCounters(){ acquired = contended = 0; }
+
+    private:
+        std::atomic<uint32_t> next{0}, serving{0};
+        uint32_t acquired = 0, contended = 0;
+    };
+
+    /**Critical section for a single core board. Holding it masks interrupts (PRIMASK, SREG or __disable_interrupt), so
+     * the loop and an interrupt never run inside it together. It nests, the mask is put back when the outermost
+     * Unlock runs. Keep it short, interrupts that come in meanwhile wait**/
+    struct InterruptLock{
+        InterruptLock(){}
+        InterruptLock(const InterruptLock&) = delete;
+
+        inline void Lock(){
+            auto s = NativeInterruptsOff();
+            if(depth++ == 0)
+                state = s;
+            else nested++;
+            acquired++;
+        }
+
+        inline bool TryLock(){
+            Lock();
+            return true;
+        }
+
+        inline void Unlock(){
+            if(--depth == 0)
+                NativeInterruptsRestore(state);
+        }
+
+        inline bool IsLocked() const { return depth > 0; }
+
+        inline uint32_t Acquired() const { return acquired; }
+        inline uint32_t Nested() const { return nested; }            //Times it was taken while already held
+        void ResetCounters(){ acquired = nested = 0; }
+
+    private:
+        uint32_t state = 0, acquired = 0, nested = 0;
+        uint8_t depth = 0;
+    };
+
+/**The lock SimpleLock is built on. Boards share data with interrupts, the PC with threads**/
+#ifdef ARDUINO
+    typedef InterruptLock PlatformLock;
+#else
+    typedef SpinLock PlatformLock;
+#endif
+}
 
 typedef struct SimpleLock{
-    volatile uint8_t lock;
+    Simple::PlatformLock lock;
 } SimpleLock;
 
 void SimpleLock_Init(SimpleLock* lock){
-    lock->lock = false;
+    new (&lock->lock) Simple::PlatformLock();
 }
 
 void SimpleLock_Lock(SimpleLock* lock){
-    while(lock->lock);
-    lock->lock = true;
+    lock->lock.Lock();
 }
 
 void SimpleLock_Unlock(SimpleLock* lock){
-    lock->lock = false;
+    lock->lock.Unlock();
 }
 
 bool SimpleLock_IsLocked(SimpleLock* lock){
-    return lock->lock;
+    return lock->lock.IsLocked();
 }
 
-void SimpleLock_Destroy(SimpleLock* lock){
-    lock->lock = false;
-}
+void SimpleLock_Destroy(SimpleLock*){}
 
-#define SimpleLockBlock(lock, ...){ \
-        while(!(lock)->lock);        \
-            (lock)->lock = true;     \
-        __VA_ARGS__                  \
-        (lock)->lock = false;        \
+#define SimpleLockBlock(lock, ...){     \
+        SimpleLock_Lock(lock);          \
+        __VA_ARGS__                     \
+        SimpleLock_Unlock(lock);        \
 }
 
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,295 @@
+/**********************************************************************
+   NAME: SimpleLog.hpp
+   AUTHOR: Johnathan Bizzano
+   DATE: 10/17/2026
+
+    The Simple Project
+		Medium Level (from Low) library that abstracts away from embedded device hardware
+
+    Simple Log
+		Deferred binary logging. The device sends a 16 bit id of the format string and the raw arguments
+		instead of the formatted text. Every logged format is put in the .simple_log section of the firmware
+		elf when it is compiled, and a LogTable built on that section turns the binary logs back into text.
+		SpinorGUI.jl does not decode logs, so BINARY_LOG is for host tools built on LogTable
+*********************************************************************/
+
+#ifndef SIMPLE_LOG_H
+#define SIMPLE_LOG_H
+
+#include "SimpleIO.hpp"
+#include "SimpleTask.hpp"
+
+namespace Simple{
+    typedef uint16_t LogId;
+
+    namespace Log{
+        /**FNV-1a hash of a string**/
+        constexpr uint32_t Hash(const char* s, uint32_t h = 2166136261u){
+            return *s == '\0' ? h : Hash(s + 1, (h ^ (uint8_t) *s) * 16777619u);
+        }
+
+        /**Id of a format string. Folded down to 16 bits to keep the log header small**/
+        constexpr LogId Id(const char* fmt){ return (LogId) (Hash(fmt) ^ (Hash(fmt) >> 16)); }
+
+        /**Write an unsigned varint (7 bits per byte, high bit set if more follow)**/
+        template<typename TIO> inline void WriteVarint(TIO& io, uint64_t v){
+            uint8_t buffer[10];
+            int n = 0;
+            while(v >= 0x80){
+                buffer[n++] = (uint8_t) (v | 0x80);
+                v >>= 7;
+            }
+            buffer[n++] = (uint8_t) v;
+            io.WriteBytes(buffer, n);
+        }
+
+        /**Read an unsigned varint. Return false if the stream ran out first**/
+        inline bool ReadVarint(IO& io, uint64_t* v){
+            *v = 0;
+            for(int shift = 0; shift < 64; shift += 7){
+                int b = io.BytesAvailable() > 0 ? io.ReadByte() : -1;
+                if(b < 0)
+                    return false;
+                *v |= (uint64_t) (b & 0x7F) << shift;
+                if((b & 0x80) == 0)
+                    return true;
+            }
+            return false;
+        }
+
+        /**Encode one argument with conversion C
+         * %c %b -> 1 byte. %i %l -> zigzag varint. %u %U %p -> varint. %f -> float32. %d -> float64. %s -> length byte + chars**/
+        template<char C> struct Arg;
+        template<> struct Arg<'c'>{ template<typename TIO, typename T> static inline void Write(TIO& io, T t){ io.WriteByte((uint8_t) t); } };
+        template<> struct Arg<'b'>{ template<typename TIO, typename T> static inline void Write(TIO& io, T t){ io.WriteByte(t ? 1 : 0); } };
+        template<> struct Arg<'i'>{ template<typename TIO, typename T> static inline void Write(TIO& io, T t){
+            auto v = (int64_t) t;
+            WriteVarint(io, ((uint64_t) v << 1) ^ (uint64_t) (v >> 63));
+        } };
+        template<> struct Arg<'l'> : Arg<'i'>{};
+        template<> struct Arg<'u'>{ template<typename TIO, typename T> static inline void Write(TIO& io, T t){ WriteVarint(io, (uint64_t) t); } };
+        template<> struct Arg<'U'> : Arg<'u'>{};
+        template<> struct Arg<'p'>{ template<typename TIO, typename T> static inline void Write(TIO& io, T t){ WriteVarint(io, (uint64_t) (uintptr_t) t); } };
+        template<> struct Arg<'f'>{ template<typename TIO, typename T> static inline void Write(TIO& io, T t){ io.WriteStd((float) t); } };
+        template<> struct Arg<'d'>{ template<typename TIO, typename T> static inline void Write(TIO& io, T t){ io.WriteStd((double) t); } };
+        template<> struct Arg<'s'>{ template<typename TIO, typename T> static inline void Write(TIO& io, T t){
+            const char* s = t != nullptr ? t : "null";
+            auto n = (uint8_t) min(strlen(s), (size_t) 255);
+            io.WriteByte(n);
+            io.WriteBytes((uint8_t*) s, n);
+        } };
+
+        /**Walk the conversions of the format from Pos, encoding one argument per conversion**/
+        template<typename F, int Pos, typename... Args> struct Encoder;
+
+        template<typename F, int Pos> struct Encoder<F, Pos>{
+            static_assert(F::value()[Format::NextSpec(F::value(), Pos)] == '\0', "Format string has more conversions than arguments");
+
+            template<typename TIO> static inline void Write(TIO&){}
+        };
+
+        template<typename F, int Pos, typename T, typename... Rest> struct Encoder<F, Pos, T, Rest...>{
+            static constexpr int Spec = Format::NextSpec(F::value(), Pos);
+            static constexpr char Conversion = F::value()[Spec] == '\0' ? '\0' : F::value()[Spec + 1];
+            static_assert(Conversion != '\0', "Format string has fewer conversions than arguments");
+            static_assert(Conversion == '\0' || Format::Accepts<typename std::decay<T>::type>(Conversion), "Argument type does not match its format conversion");
+
+            template<typename TIO> static inline void Write(TIO& io, T t, Rest... rest){
+                Arg<Conversion>::Write(io, t);
+                Encoder<F, Spec + 2, Rest...>::Write(io, rest...);
+            }
+        };
+
+        /**Write a histogram as a bit mask of its non zero buckets followed by their counts**/
+        template<typename TIO> inline void WriteHistogram(TIO& io, const uint16_t* histogram, int buckets){
+            uint64_t mask = 0;
+            for(int i = 0; i < buckets; i++)
+                if(histogram[i] != 0)
+                    mask |= (uint64_t) 1 << i;
+            WriteVarint(io, mask);
+            for(int i = 0; i < buckets; i++)
+                if(histogram[i] != 0)
+                    WriteVarint(io, histogram[i]);
+        }
+
+#ifdef SIMPLE_PROFILE
+        /**Write the stats of every Profile as one record. Send it over a connection like this
+         *  packet.Clear(); Log::WriteProfiles(packet); connection.Send(&packet);
+         * Layout: [Count][Buckets] then per profile [Name Length (1)][Name][Runs][Total us][Longest us][Run Time Histogram][Lateness Histogram].
+         * Numbers are varints**/
+        template<typename TIO> inline void WriteProfiles(TIO& io){
+            int count = 0;
+            for(auto p = Profile::First(); p != nullptr; p = p->Next())
+                count++;
+            WriteVarint(io, count);
+            WriteVarint(io, Profile::Buckets);
+            for(auto p = Profile::First(); p != nullptr; p = p->Next()){
+                Arg<'s'>::Write(io, p->name);
+                WriteVarint(io, p->runs);
+                WriteVarint(io, p->total);
+                WriteVarint(io, p->longest);
+                WriteHistogram(io, p->run_time, Profile::Buckets);
+                WriteHistogram(io, p->lateness, Profile::Buckets);
+            }
+        }
+#endif
+
+        /**Write a binary log of a SimpleFormat string to the io. Use it like this
+         *  Log::Write(packet, SimpleFormat("Speed %i: %f"), id, speed); **/
+        template<typename TIO, typename F, typename... Args>
+        inline typename enable_if<is_base_of<FormatString, F>::value>::type Write(TIO& io, F, Args... args){
+            constexpr LogId id = Id(F::value());
+            F::Intern();
+            io.WriteStd(id);
+            Encoder<F, 0, Args...>::Write(io, args...);
+        }
+    }
+
+    /**Host side view of the format table of a firmware, the .simple_log section of its elf. Turns binary logs back into text.
+     * The section is a list of null terminated formats, copy it out with
+     *  objcopy --dump-section .simple_log=formats.bin firmware.elf /dev/null
+     * and hand its bytes to LogTable(begin, end). The same format logged from several places is in it more than once**/
+    struct LogTable{
+        const char *begin, *end;
+
+        LogTable(const void* begin, const void* end) : begin((const char*) begin), end((const char*) end){}
+
+        /**Find the format of $id and put its length in $length. Return nullptr if it is not in the table**/
+        const char* Find(LogId id, int* length) const {
+            for(auto fmt = begin; fmt < end; fmt = Next(fmt)){
+                if(Log::Id(fmt) == id){
+                    *length = (int) strnlen(fmt, end - fmt);
+                    return fmt;
+                }
+            }
+            return nullptr;
+        }
+
+        /**Number of formats whose id is shared with a different format. Reword one of them, the device cannot tell them apart**/
+        int Collisions() const {
+            int collisions = 0, length;
+            for(auto fmt = begin; fmt < end; fmt = Next(fmt))
+                if(strncmp(Find(Log::Id(fmt), &length), fmt, end - fmt) != 0)
+                    collisions++;
+            return collisions;
+        }
+
+        /**Decode one binary log from $in and print it to $out. Return false if the id is unknown or the log was cut short**/
+        bool Decode(IO& in, IO& out) const {
+            LogId id;
+            if(!in.TryReadStd(&id))
+                return false;
+            int size;
+            auto fmt = Find(id, &size);
+            if(fmt == nullptr){
+                out.Printf("<Unknown Log %u>\r\n", (unsigned int) id);
+                return false;
+            }
+
+            char buffer[Convert::BufferSize];
+            int run = 0;
+            for(int i = 0; i < size; i++){
+                if(fmt[i] != '%' || i + 1 == size || !Format::IsSpec(fmt[i + 1]))
+                    continue;
+                out.WriteBytes((uint8_t*) fmt + run, i - run);
+                if(!DecodeArg(in, out, buffer, fmt[i + 1]))
+                    return false;
+                run = ++i + 1;
+            }
+            out.WriteBytes((uint8_t*) fmt + run, size - run);
+            return true;
+        }
+
+        /**Print a record written by Log::WriteProfiles to $out. Return false if it was cut short**/
+        static bool DecodeProfiles(IO& in, IO& out){
+            uint64_t count, buckets, runs, total, longest;
+            if(!Log::ReadVarint(in, &count) || !Log::ReadVarint(in, &buckets))
+                return false;
+            char name[256];
+            for(uint64_t i = 0; i < count; i++){
+                uint8_t n;
+                if(!in.TryRead(&n) || in.BytesAvailable() < n) return false;
+                in.Read((uint8_t*) name, n);
+                name[n] = '\0';
+                if(!Log::ReadVarint(in, &runs) || !Log::ReadVarint(in, &total) || !Log::ReadVarint(in, &longest))
+                    return false;
+                out.Printf("%s: Runs=%U Total us=%U Mean us=%U Max us=%U\r\n", name, runs, total, runs > 0 ? total / runs : 0, longest);
+                if(!DecodeHistogram(in, out, "\tRun us", buckets) || !DecodeHistogram(in, out, "\tLate us", buckets))
+                    return false;
+            }
+            return true;
+        }
+
+    private:
+        inline const char* Next(const char* fmt) const { return fmt + strnlen(fmt, end - fmt) + 1; }
+
+        /**Print the non zero buckets as "<Upper Bound:Count". The last bucket is open ended**/
+        static bool DecodeHistogram(IO& in, IO& out, const char* label, uint64_t buckets){
+            uint64_t mask, c;
+            if(!Log::ReadVarint(in, &mask))
+                return false;
+            if(mask == 0)
+                return true;
+            out.WriteUnsafeString(label);
+            for(uint64_t i = 0; i < buckets; i++){
+                if((mask & ((uint64_t) 1 << i)) == 0)
+                    continue;
+                if(!Log::ReadVarint(in, &c))
+                    return false;
+                if(i + 1 == buckets) out.Printf(" >=%U:%U", (uint64_t) 1 << (i - 1), c);
+                else out.Printf(" <%U:%U", (uint64_t) 1 << i, c);
+            }
+            out.WriteUnsafeString("\r\n");
+            return true;
+        }
+
+        static bool DecodeArg(IO& in, IO& out, char* buffer, char c){
+            uint64_t v;
+            switch(c){
+                case 'c':
+                case 'b':{
+                    uint8_t b;
+                    if(!in.TryRead(&b)) return false;
+                    if(c == 'c') out.WriteByte(b);
+                    else out.WriteUnsafeString(b ? "true" : "false");
+                    return true;
+                }
+                case 'i':
+                case 'l':
+                    if(!Log::ReadVarint(in, &v)) return false;
+                    out.PrintInt64(buffer, (int64_t) (v >> 1) ^ -(int64_t) (v & 1));
+                    return true;
+                case 'u':
+                case 'U':
+                case 'p':
+                    if(!Log::ReadVarint(in, &v)) return false;
+                    out.PrintUInt64(buffer, v);
+                    return true;
+                case 'f':{
+                    float f;
+                    if(!in.TryReadStd(&f)) return false;
+                    out.PrintFloat64(buffer, f, Convert::Trimmed);
+                    return true;
+                }
+                case 'd':{
+                    double d;
+                    if(!in.TryReadStd(&d)) return false;
+                    out.PrintFloat64(buffer, d);
+                    return true;
+                }
+                case 's':{
+                    uint8_t n;
+                    if(!in.TryRead(&n) || in.BytesAvailable() < n) return false;
+                    uint8_t chars[255];
+                    in.Read(chars, n);
+                    out.WriteBytes(chars, n);
+                    return true;
+                }
+                default:
+                    return false;
+            }
+        }
+    };
+}
+
+#endif
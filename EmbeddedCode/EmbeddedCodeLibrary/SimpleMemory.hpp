@@ -7,42 +7,337 @@
 		Medium Level (from Low) library that abstracts away from embedded device hardware
 
     Simple Memory
-		Provide abstract Ref support (local refs, global refs, static refs etc)
+		Provide abstract Ref support (local refs, global refs, static refs etc). Refs count inside the block they
+		own, without atomics unless they are shared between threads
+		Fixed block pools and bump arenas so long running devices do not fragment the heap
 *********************************************************************/
 
 #ifndef SIMPLE_MEMORY_H
 #define SIMPLE_MEMORY_H
 
 #include <stdint.h>
-#include <memory>
+#include <stddef.h>
+#include <new>
+#include <atomic>
+#include <utility>
 
 namespace Simple{
-    template<typename T>
-    struct RefDeleter{
-        bool shouldDelete = false;
+    struct Empty{};
+
+    /**Where blocks of memory come from**/
+    struct Allocator{
+        virtual ~Allocator(){}
+
+        /**$bytes aligned for any type. nullptr when there is no memory left**/
+        virtual void* Allocate(size_t bytes) = 0;
+        virtual void Free(void* p) = 0;
+    };
+
+    struct HeapAllocator : public Allocator{
+        void* Allocate(size_t bytes) override { return ::operator new(bytes, std::nothrow); }
+        void Free(void* p) override { ::operator delete(p); }
+    };
+
+    /**The heap**/
+    HeapAllocator Heap;
+
+    /**Fixed block allocator for $N objects of $T. The blocks sit in one array and the free ones are chained through
+     * their first bytes, so Allocate and Free are O(1) and never fragment. As an Allocator it hands out a block for
+     * anything that fits in a T. Not safe from interrupts or other threads**/
+    template<typename T, int N>
+    struct Pool : public Allocator{
+        Pool(){
+            for(int i = 0; i < N; i++)
+                blocks[i].next = i + 1 < N ? &blocks[i + 1] : nullptr;
+            free_list = N > 0 ? &blocks[0] : nullptr;
+        }
+        Pool(const Pool&) = delete;
+
+        void* Allocate(size_t bytes) override {
+            if(bytes > sizeof(Block) || free_list == nullptr){
+                failures++;
+                return nullptr;
+            }
+            auto b = free_list;
+            free_list = b->next;
+            if(++used > high_water)
+                high_water = used;
+            return b;
+        }
+
+        /**A pointer that is not the start of one of its blocks is refused and counted, the free list is left alone**/
+        void Free(void* p) override {
+            if(p == nullptr)
+                return;
+            if(!Owns(p) || ((uint8_t*) p - (uint8_t*) blocks) % sizeof(Block) != 0){
+                bad_frees++;
+                return;
+            }
+            auto b = (Block*) p;
+            b->next = free_list;
+            free_list = b;
+            used--;
+        }
+
+        /**Construct a T in a free block. nullptr when the pool is empty**/
+        template<typename... A> T* New(A&&... args){
+            auto p = Allocate(sizeof(T));
+            return p != nullptr ? new (p) T(std::forward<A>(args)...) : nullptr;
+        }
+
+        void Delete(T* t){
+            if(t == nullptr)
+                return;
+            t->~T();
+            Free(t);
+        }
+
+        inline bool Owns(const void* p) const { return p >= (const void*) blocks && p < (const void*) (blocks + N); }
+        static constexpr int Capacity(){ return N; }
+        inline int Used() const { return used; }
+        inline int HighWater() const { return high_water; }
+        inline uint32_t Failures() const { return failures; }       //Allocations refused because the pool was empty or the size too big
+        inline uint32_t BadFrees() const { return bad_frees; }      //Frees of pointers that were not its blocks
+
+    private:
+        /**Aligned for any type, like the Allocator promises, even when T is a byte array**/
+        union alignas(max_align_t) Block{
+            Block* next;
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type data;
+        };
+
+        Block blocks[N];
+        Block* free_list;
+        int used = 0, high_water = 0;
+        uint32_t failures = 0, bad_frees = 0;
+    };
 
-        RefDeleter(bool shouldDelete = false) : shouldDelete(shouldDelete){}
+    /**Bump allocator over a fixed buffer. Free does nothing, the memory comes back all at once with Reset or when a
+     * Scope ends. Use it like this
+     *  StaticArena<1024> scratch;
+     *  {
+     *      Arena::Scope scope(scratch);
+     *      Packet p(scratch, 200);
+     *  }   //Everything allocated in the scope is given back **/
+    struct Arena : public Allocator{
+        Arena(uint8_t* buffer, size_t capacity) : buffer(buffer), capacity(capacity){}
+        Arena(const Arena&) = delete;
 
-        void operator()(T* p){
-            if(shouldDelete){
-                delete p;
-                shouldDelete = false;
+        void* Allocate(size_t bytes) override {
+            auto start = used + (-(uintptr_t) (buffer + used) & (alignof(max_align_t) - 1));
+            if(start + bytes > capacity){
+                failures++;
+                return nullptr;
             }
+            used = start + bytes;
+            if(used > high_water)
+                high_water = used;
+            return buffer + start;
         }
+
+        void Free(void*) override {}
+
+        /**Give back everything allocated after $mark. Objects in it must be destroyed already**/
+        inline size_t Mark() const { return used; }
+        inline void Rewind(size_t mark){ used = mark; }
+        inline void Reset(){ used = 0; }
+
+        /**Rewinds the arena to where it was when the scope started**/
+        struct Scope{
+            Arena& arena;
+            size_t mark;
+
+            explicit Scope(Arena& arena) : arena(arena), mark(arena.Mark()){}
+            Scope(const Scope&) = delete;
+            ~Scope(){ arena.Rewind(mark); }
+        };
+
+        inline size_t Capacity() const { return capacity; }
+        inline size_t Used() const { return used; }
+        inline size_t HighWater() const { return high_water; }
+        inline uint32_t Failures() const { return failures; }      //Allocations refused because the arena was full
+
+    private:
+        uint8_t* buffer;
+        size_t capacity, used = 0, high_water = 0;
+        uint32_t failures = 0;
     };
-    template<typename T> struct NoDelete{ inline void operator()(T* p){} };
 
-    template<typename T = uint8_t> using ref = std::shared_ptr<T>;
+    /**Arena with its own $Bytes of storage**/
+    template<size_t Bytes>
+    struct StaticArena : public Arena{
+        StaticArena() : Arena(storage, Bytes){}
 
-    /**Create a local reference**/
-    template<typename T> inline ref<T> LocalRef(T* t){ return ref<T>(t, NoDelete<T>()); }
+    private:
+        alignas(max_align_t) uint8_t storage[Bytes];
+    };
 
-    /**Create a heap reference**/
-    template<typename T> inline ref<T> HeapRef(T* t){ return ref<T>(new T(*t)); }
+    /**Mask interrupts and return the state to restore. Defined by the device backend**/
+    static uint32_t NativeInterruptsOff();
+    static void NativeInterruptsRestore(uint32_t state);
 
-    /**Create a reference with an owner**/
-    template<typename T> inline ref<T> Ref(T* t, bool owns){ return ref<T>(t, RefDeleter<T>(owns)); }
+    /**Count for refs that stay on one core and out of interrupts. A copy is a plain increment**/
+    struct SingleCount{
+        unsigned n = 1;
+        inline void Add(){ n++; }
+        inline bool Drop(){ return --n == 0; }
+    };
 
-    struct Empty{};
+    /**Count for refs that are also copied or dropped in interrupts. Interrupts are masked around the count**/
+    struct IsrCount{
+        volatile unsigned n = 1;
+        inline void Add(){
+            auto state = NativeInterruptsOff();
+            n = n + 1;
+            NativeInterruptsRestore(state);
+        }
+        inline bool Drop(){
+            auto state = NativeInterruptsOff();
+            bool last = (n = n - 1) == 0;
+            NativeInterruptsRestore(state);
+            return last;
+        }
+    };
+
+    /**Count for refs shared between threads, like Lambdas handed to the PC executor**/
+    struct AtomicCount{
+        std::atomic<unsigned> n{1};
+        inline void Add(){ n.fetch_add(1, std::memory_order_relaxed); }
+        inline bool Drop(){ return n.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+    };
+
+/**How refs count by default. Boards run everything on one core, the PC may share refs between threads**/
+#ifndef SIMPLE_REF_COUNT
+    #ifdef ARDUINO
+        #define SIMPLE_REF_COUNT SingleCount
+    #else
+        #define SIMPLE_REF_COUNT AtomicCount
+    #endif
+#endif
+
+    /**Header in front of every object a ref owns. The count sits in the same block as the object, so there is one
+     * allocation and nothing to look up when a ref is copied**/
+    template<typename Count>
+    struct RefBlock{
+        Count count;
+        Allocator* from;
+        void (*destroy)(void* object);      //Destructor of the object. nullptr for plain bytes
+
+        static constexpr size_t Header = (sizeof(Count) + 2 * sizeof(void*) + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1);
+
+        RefBlock(Allocator* from, void (*destroy)(void*)) : from(from), destroy(destroy){}
+
+        inline void* Object(){ return (uint8_t*) this + Header; }
+
+        /**Block with room for $bytes from $from. nullptr when it is out of memory**/
+        static RefBlock* New(Allocator& from, size_t bytes, void (*destroy)(void*)){
+            auto p = from.Allocate(Header + bytes);
+            return p != nullptr ? new (p) RefBlock(&from, destroy) : nullptr;
+        }
+
+        inline void Add(){ count.Add(); }
+
+        /**Drop a reference. The last one destroys the object and gives the block back**/
+        inline void Release(){
+            if(!count.Drop())
+                return;
+            if(destroy != nullptr)
+                destroy(Object());
+            auto f = from;
+            this->~RefBlock();
+            f->Free(this);
+        }
+    };
+    template<typename Count> constexpr size_t RefBlock<Count>::Header;
+
+    /**Bytes a ref block needs in front of the object. Size pool blocks that back refs with it**/
+    constexpr size_t RefHeader = RefBlock<SIMPLE_REF_COUNT>::Header;
+
+    /**Reference counted pointer with the count inside the block it owns. $Count picks how it counts (SingleCount,
+     * IsrCount or AtomicCount). A ref without a block (LocalRef) does not own what it points at**/
+    template<typename T, typename Count = SIMPLE_REF_COUNT>
+    struct Shared{
+        typedef RefBlock<Count> Block;
+
+        Shared(){}
+        Shared(std::nullptr_t){}
+        /**Point at $ptr and take over the reference $block holds. $block may be nullptr to not own $ptr**/
+        Shared(T* ptr, Block* block) : ptr(ptr), block(block){}
+        Shared(const Shared& o) : ptr(o.ptr), block(o.block){
+            if(block != nullptr)
+                block->Add();
+        }
+        Shared(Shared&& o) : ptr(o.ptr), block(o.block){
+            o.ptr = nullptr;
+            o.block = nullptr;
+        }
+        ~Shared(){
+            if(block != nullptr)
+                block->Release();
+        }
+
+        Shared& operator=(const Shared& o){
+            if(o.block != block){       //Refs to the same block leave the count alone
+                if(o.block != nullptr)
+                    o.block->Add();
+                if(block != nullptr)
+                    block->Release();
+                block = o.block;
+            }
+            ptr = o.ptr;
+            return *this;
+        }
+        Shared& operator=(Shared&& o){
+            swap(o);
+            return *this;
+        }
+
+        inline T* get() const { return ptr; }
+        inline T& operator*() const { return *ptr; }
+        inline T* operator->() const { return ptr; }
+        explicit operator bool() const { return ptr != nullptr; }
+
+        void reset(){ Shared().swap(*this); }
+        void swap(Shared& o){
+            std::swap(ptr, o.ptr);
+            std::swap(block, o.block);
+        }
+
+    private:
+        T* ptr = nullptr;
+        Block* block = nullptr;
+    };
+
+    template<typename T = uint8_t> using ref = Shared<T>;
+
+    /**Ref to $bytes from $from. Empty when it is out of memory. The block is RefHeader bytes bigger**/
+    inline ref<uint8_t> AllocateRef(Allocator& from, size_t bytes){
+        auto b = ref<uint8_t>::Block::New(from, bytes, nullptr);
+        return b != nullptr ? ref<uint8_t>((uint8_t*) b->Object(), b) : ref<uint8_t>();
+    }
+
+    /**Ref to a T constructed in memory from $from. Empty when it is out of memory. The block is RefHeader bytes bigger**/
+    template<typename T, typename... A> inline ref<T> MakeRef(Allocator& from, A&&... args){
+        auto b = ref<T>::Block::New(from, sizeof(T), [](void* t){ ((T*) t)->~T(); });
+        return b != nullptr ? ref<T>(new (b->Object()) T(std::forward<A>(args)...), b) : ref<T>();
+    }
+
+    /**Create a local reference. It has no block so there is nothing to count**/
+    template<typename T> inline ref<T> LocalRef(T* t){ return ref<T>(t, nullptr); }
+
+    /**Create a heap reference**/
+    template<typename T> inline ref<T> HeapRef(T* t){ return MakeRef<T>(Heap, *t); }
+
+    /**Create a reference with an owner. An owned $t was made with new, its block only holds the pointer to delete**/
+    template<typename T> inline ref<T> Ref(T* t, bool owns){
+        if(!owns)
+            return LocalRef(t);
+        auto b = ref<T>::Block::New(Heap, sizeof(T*), [](void* p){ delete *(T**) p; });
+        if(b == nullptr)
+            return ref<T>();
+        *(T**) b->Object() = t;
+        return ref<T>(t, b);
+    }
 }
-#endif
\ No newline at end of file
+
+#endif
@@ -15,70 +15,304 @@
 
 #include <vector>
 #include <stdint.h>
+#include <time.h>
+#include <atomic>
 #include "SimpleLambda.hpp"
+#include "SimpleIO.hpp"
 
 using namespace std;
 
+/**Define SIMPLE_PROFILE to time every task the scheduler runs. Without it the profiler compiles to nothing**/
+#ifdef SIMPLE_PROFILE
+    #define profileOnly(...) __VA_ARGS__
+    #ifndef SIMPLE_PROFILE_SLOTS
+        #define SIMPLE_PROFILE_SLOTS 16         //Tasks and timers that get a record of their own without a named Profile
+    #endif
+#else
+    #define profileOnly(...)
+#endif
+
 namespace Simple{
     enum TaskReturn : uint8_t{
         Nothing = 0,
         Disposed = 1
     };
 
+#ifdef SIMPLE_PROFILE
+    struct Task;
+
+    /**Run statistics of a task or of a group of tasks sharing it. Times are in microseconds.
+     * Every task and timer gets a record of its own the first time it runs, named after its kind and address (look the
+     * address up with nm or the map file). Make a named Profile to give it a readable name or to group tasks.
+     * Histogram bucket 0 counts 0 us and bucket i counts [2^(i-1), 2^i) us. The last bucket also holds everything longer**/
+    struct Profile{
+        static constexpr int Buckets = 20;
+
+        const char* name;
+        uint32_t runs = 0, longest = 0;
+        uint64_t total = 0;
+        uint16_t run_time[Buckets] = {};        //How long Fire took
+        uint16_t lateness[Buckets] = {};        //How long after its deadline a timer fired
+
+        explicit Profile(const char* name) : name(name), next(first), listed(true){ first = this; }
+
+        /**Count the runs of $task here. The profile must outlive the task**/
+        Profile(const char* name, Task& task);
+
+        Profile(const Profile&) = delete;
+        ~Profile(){
+            for(auto p = &first; *p != nullptr; p = &(*p)->next)
+                if(*p == this){
+                    *p = next;
+                    break;
+                }
+        }
+
+        /**Walk every profile with First() and Next()**/
+        static Profile* First(){ return first; }
+        Profile* Next(){ return next; }
+
+        static int Bucket(uint32_t us){
+            int b = 0;
+            for(; us != 0 && b < Buckets - 1; us >>= 1)
+                b++;
+            return b;
+        }
+
+        void Run(uint32_t us){
+            runs++;
+            total += us;
+            longest = max(longest, us);
+            Count(run_time, us);
+        }
+
+        void Late(uint32_t us){ Count(lateness, us); }
+
+        void Reset(){
+            runs = longest = 0;
+            total = 0;
+            for(int i = 0; i < Buckets; i++)
+                run_time[i] = lateness[i] = 0;
+        }
+
+        static void ResetAll(){
+            for(auto p = first; p != nullptr; p = p->next)
+                p->Reset();
+        }
+
+        /**The profile the runs of $t go to. A task without one takes a free slot the first time**/
+        static inline Profile* Of(Task* t, const char* kind = "Task");
+
+        /**Give up the slot $t took, the next task to run without a profile reuses it. The stats stay until then**/
+        static inline void Release(Task* t);
+
+        /**Tasks that ran once every slot was taken**/
+        static Profile Other;
+
+    private:
+        static Profile* first;
+        static Profile slots[SIMPLE_PROFILE_SLOTS];
+        Profile* next = nullptr;
+        Task* owner = nullptr;                  //The task holding this slot
+        bool listed = false;
+        char label[8 + 2 * sizeof(void*)];      //"<kind> <address in hex>" of a slot
+
+        Profile() : name(label){ label[0] = '\0'; }
+
+        /**Take a free slot for $t, or Other if there is none**/
+        static Profile* Claim(Task* t, const char* kind){
+            for(auto& s : slots){
+                if(s.owner != nullptr)
+                    continue;
+                s.owner = t;
+                s.Reset();
+                s.Label(kind, (uintptr_t) t);
+                if(!s.listed){
+                    s.next = first;
+                    first = &s;
+                    s.listed = true;
+                }
+                return &s;
+            }
+            return &Other;
+        }
+
+        void Label(const char* kind, uintptr_t address){
+            int n = 0;
+            while(*kind != '\0' && n < 5)
+                label[n++] = *(kind++);
+            label[n++] = ' ';
+            for(int shift = 8 * sizeof(void*) - 4; shift >= 0; shift -= 4)
+                label[n++] = "0123456789abcdef"[(address >> shift) & 0xF];
+            label[n] = '\0';
+        }
 
-    /**Represents a piece of code that will be executed when yielded**/
+        static void Count(uint16_t* histogram, uint32_t us){
+            auto& c = histogram[Bucket(us)];
+            if(c != UINT16_MAX)
+                c++;
+        }
+    };
+#endif
+
+
+    /**Represents a piece of code that will be executed when yielded.
+     * Started tasks sit in an intrusive doubly linked list so starting and stopping is O(1) and safe from inside Fire**/
     struct Task{
     private:
-        static vector<Task*> tasks;
-        volatile int ID = -1;
+        /**Position of a running Yield. Stop moves it along when it removes the task it points at**/
+        struct Cursor{
+            Task* next;
+            Cursor* outer;
+        };
+
+        static Task* head, *tail;
+        static Cursor* cursors;
+        static uint64_t duty_since, duty_idle;        //Microseconds
+        Task* prev = nullptr, *next = nullptr;
+        bool listed = false;
     public:
-        virtual ~Task(){ Stop(); }
+        static constexpr uint32_t Never = UINT32_MAX;
+        static constexpr uint32_t IdleLimit = 100;         //Longest single sleep so code in loop() still runs now and then
+
+        Task(){}
+        Task(const Task&){}                                 //A copy is not started
+        Task& operator=(const Task&){ return *this; }
+        virtual ~Task(){
+            Stop();
+            profileOnly(Profile::Release(this);)
+        }
 
-        inline bool Active(){ return ID != -1; }
+#ifdef SIMPLE_PROFILE
+        Profile* profile = nullptr;                         //Where its runs are counted. A slot of its own if not set
+#endif
+
+        virtual bool Active(){ return listed; }
 
         /**Fire the code**/
         virtual TaskReturn Fire() = 0;
 
+        /**Milliseconds the task can go without firing. 0 means it polls something and must fire every Yield**/
+        virtual uint32_t IdleFor(){ return 0; }
+
         /**Allow the task to be executed**/
         virtual void Start(){
-            if(!Active()){
-                ID = tasks.size();
-                tasks.push_back(this);
-            }
+            if(listed)
+                return;
+            prev = tail;
+            next = nullptr;
+            if(tail != nullptr)
+                tail->next = this;
+            else
+                head = this;
+            tail = this;
+            listed = true;
         }
 
         /**Stop the task from being executed**/
         virtual void Stop(){
-            if(Active()){
-                tasks.erase(tasks.begin() + ID);
-                ID = -1;
-            }
+            if(!listed)
+                return;
+            for(auto c = cursors; c != nullptr; c = c->outer)
+                if(c->next == this)
+                    c->next = next;
+            (prev != nullptr ? prev->next : head) = next;
+            (next != nullptr ? next->prev : tail) = prev;
+            prev = next = nullptr;
+            listed = false;
+        }
+
+        static bool CanYield(){ return head != nullptr; }
+
+        /**Milliseconds until a started task needs to fire**/
+        static uint32_t IdleTime(){
+            uint32_t idle = Never;
+            for(auto t = head; t != nullptr && idle > 0; t = t->next)
+                idle = min(idle, t->IdleFor());
+            return idle;
         }
 
-        static bool CanYield(){ return tasks.size() > 0; }
-        static void Yield(Task* t){ t->Fire(); }
+        /**Sleep until a task needs to fire or an interrupt / IO event comes in, at most $limit milliseconds**/
+        static void Idle(uint32_t limit = IdleLimit);
 
-        /**Run all available tasks**/
+        /**Share of the time spent running code rather than idling since the last reset (0 to 1)**/
+        static float DutyCycle();
+        static void ResetDutyCycle();
+
+        /**Number of started tasks. Walks the list**/
+        static int Count(){
+            int n = 0;
+            for(auto t = head; t != nullptr; t = t->next)
+                n++;
+            return n;
+        }
+
+#ifdef SIMPLE_PROFILE
+        /**Fire $t and count the run in its profile**/
+        static inline TaskReturn Run(Task* t);
+#else
+        static TaskReturn Run(Task* t){ return t->Fire(); }
+#endif
+
+        static void Yield(Task* t){ Run(t); }
+
+        /**Run all available tasks, then flush the FlushOnYield buffers. A task started while yielding is added at the end of
+         * the list. It runs in the same pass unless it was started by the last task, whose successor was already read as
+         * none, then it runs in the next pass**/
         static void Yield() {
-            for(int i = 0; i < tasks.size(); i++){
-                if(tasks[i]->Fire() != TaskReturn::Nothing){
-                    i--;
-                }
+            Cursor cursor{head, cursors};
+            cursors = &cursor;
+            while(cursor.next != nullptr){
+                auto t = cursor.next;
+                cursor.next = t->next;
+                Run(t);
             }
+            cursors = cursor.outer;
+            BufferedIO::FlushYielded();
         }
 
         /**Wait for x seconds. In the meantime run background tasks**/
         static void Wait(uint32_t milliseconds);
     };
 
-    vector<Task*> Task::tasks;
+    constexpr uint32_t Task::Never;
+    constexpr uint32_t Task::IdleLimit;
+    Task* Task::head = nullptr;
+    Task* Task::tail = nullptr;
+    Task::Cursor* Task::cursors = nullptr;
+    uint64_t Task::duty_since = 0;
+    uint64_t Task::duty_idle = 0;
+
+#ifdef SIMPLE_PROFILE
+    Profile* Profile::first = nullptr;
+    constexpr int Profile::Buckets;
+    Profile Profile::Other("Other");
+    Profile Profile::slots[SIMPLE_PROFILE_SLOTS];
+
+    Profile::Profile(const char* name, Task& task) : Profile(name){
+        Release(&task);
+        task.profile = this;
+    }
+
+    Profile* Profile::Of(Task* t, const char* kind){
+        if(t->profile == nullptr)
+            t->profile = Claim(t, kind);
+        return t->profile;
+    }
+
+    void Profile::Release(Task* t){
+        if(t->profile != nullptr && t->profile->owner == t)
+            t->profile->owner = nullptr;
+    }
+#endif
 
     /**Wait for x seconds. In the meantime run background tasks**/
     inline void Wait(uint32_t milliseconds){ Task::Wait(milliseconds); }
 
-    /**Run all available tasks**/
+    /**Run all available tasks then sleep until one of them needs to fire again**/
     inline bool Yield(){
         Task::Yield();
+        Task::Idle();
         return Task::CanYield();
     }
 
@@ -98,12 +332,13 @@ namespace Simple{
         }
     };
 
-    /**Wrapper over a lambda to provide async code**/
+    /**Wrapper over a lambda to provide async code. The captures are kept in the task**/
     struct AsyncTask : public Task{
-        Lambda<void()> callback;
+        InlineLambda<void()> callback;
+        Allocator* from = &Heap;        //The task is given back here when it is done
 
         ~AsyncTask() override{ Task::Stop(); }
-        AsyncTask(Lambda<void()> callback) : callback(std::move(callback)){}
+        AsyncTask(InlineLambda<void()> callback) : callback(std::move(callback)){}
 
         TaskReturn Fire() final{
             callback();
@@ -111,20 +346,27 @@ namespace Simple{
             return TaskReturn::Disposed;
         }
 
-        void Stop() final{ delete this; }
+        void Stop() final{
+            auto a = from;
+            this->~AsyncTask();
+            a->Free(this);
+        }
     };
 
-    /**Run a lambda asynchronously**/
-    AsyncTask* Async(Lambda<void()> callback){
-        auto task = new AsyncTask(std::move(callback));
+    /**Run a lambda asynchronously with the task in memory from $from. Use a Pool<AsyncTask, N> so firing often never
+     * touches the heap. Returns nullptr (and the lambda never runs) when $from is out of memory**/
+    AsyncTask* Async(InlineLambda<void()> callback, Allocator& from = Heap){
+        auto p = from.Allocate(sizeof(AsyncTask));
+        if(p == nullptr)
+            return nullptr;
+        auto task = new (p) AsyncTask(std::move(callback));
+        task->from = &from;
         task->Start();
         return task;
     }
 
-/**Run a lambda asynchronously**/
-#define async(capture, ...)                                                             \
-        make_local_lambda(CAT(__async, __LINE__), capture, void, (), __VA_ARGS__);    \
-        Async(CAT(__async, __LINE__))
+/**Run a lambda asynchronously. The captures are copied into the task so locals may go out of scope**/
+#define async(capture, ...) Async(capture () -> void { __VA_ARGS__; })
 }
 
 #endif
\ No newline at end of file
@@ -19,6 +19,45 @@
 namespace Simple {
     static time_t NativeMillis();
 
+    /**Microseconds from a monotonic clock. 64 bits so it never wraps**/
+    static uint64_t NativeMicros();
+
+    /**Extends a wrapping 32 bit tick counter to 64 bits. It has to see every wrap, so read it at least once per period**/
+    struct TickExtender{
+        uint32_t last = 0;
+        uint64_t high = 0;
+
+        inline uint64_t Extend(uint32_t now){
+            if(now < last)
+                high += (uint64_t) 1 << 32;
+            last = now;
+            return high | now;
+        }
+    };
+
+    /**Put the device to sleep for up to $milliseconds. It may wake early on an interrupt or IO event**/
+    static void NativeIdle(uint32_t milliseconds);
+
+    /**Cut a NativeIdle short from another thread. Safe from any thread or interrupt**/
+    static void NativeWake();
+
+    /**Where the scheduler gets its time from and how it waits. Without one installed the native clock of the device is used**/
+    struct ClockSource{
+        virtual ~ClockSource(){}
+        virtual uint64_t Micros() = 0;
+        virtual void Idle(uint32_t milliseconds) = 0;
+    };
+
+    /**Installed clock source. nullptr for the native clock**/
+    ClockSource* TimeSource = nullptr;
+
+    inline uint64_t ClockMicros(){ return TimeSource != nullptr ? TimeSource->Micros() : NativeMicros(); }
+    inline time_t ClockMillis(){ return TimeSource != nullptr ? (time_t) (TimeSource->Micros() / 1000) : NativeMillis(); }
+    inline void ClockIdle(uint32_t milliseconds){
+        if(TimeSource != nullptr) TimeSource->Idle(milliseconds);
+        else NativeIdle(milliseconds);
+    }
+
     struct TimerController;
     template<typename T = uint32_t>
     struct Time;
@@ -47,7 +86,9 @@ namespace Simple {
         bool cycleParity;
     public:
         Time() : cycleParity(false) {}
-        T Millis()  { return static_cast<T>(NativeMillis()); }
+        /**A 64 bit Time counts from the microsecond clock so it never wraps**/
+        T Millis()  { return sizeof(T) > 4 ? static_cast<T>(ClockMicros() / 1000) : static_cast<T>(ClockMillis()); }
+        T Micros()  { return static_cast<T>(ClockMicros()); }
         TimeDecay<T> createDecay(T decay) {
             TimeDecay<T> t;
             auto now = Millis();
@@ -86,54 +127,334 @@ namespace Simple {
     /**Default Clock**/
     Time<> Clock;
 
+    /**Wrap free clock. The timer schedule runs on it**/
+    Time<uint64_t> Clock64;
+
+    class Timer;
+
+    /**Deadline ordered schedule of the started timers. A binary min heap on the deadline so a Yield reads the clock
+     * once and only touches the timers that are due, however many are waiting**/
+    struct TimerController : public Task{
+        using TimeT = uint64_t;             //Milliseconds on Clock64
+
+        static inline bool Due(TimeT deadline, TimeT now){ return now >= deadline; }
+
+        /**Order of the schedule. By deadline, then higher priority, then shorter period (rate monotonic) for timers due at the same time**/
+        static inline bool Before(Timer* a, Timer* b);
+
+        /**Milliseconds from $now to $deadline, 0 if it passed**/
+        static inline uint32_t Until(TimeT deadline, TimeT now){ return now >= deadline ? 0 : (uint32_t) min<TimeT>(deadline - now, Never); }
+
+        /**Add the timer or move it if its deadline changed**/
+        inline void Schedule(Timer* t);
+
+        /**Take the timer out of the schedule**/
+        inline void Remove(Timer* t);
+
+        /**Milliseconds until the next timer is due. 0 if one is due now and Never if there are no timers**/
+        inline uint32_t UntilNext();
+
+        inline int Size(){ return heap.size(); }
+
+        uint32_t IdleFor() override { return UntilNext(); }
+
+        /**Fire every timer that is due**/
+        inline TaskReturn Fire() override;
+
+    private:
+        vector<Timer*> heap;
+
+        inline void Place(int slot, Timer* t);
+        inline void SiftUp(int slot);
+        inline void SiftDown(int slot);
+    };
+
+    /**Default timer schedule**/
+    TimerController Timers;
+    profileOnly(Profile TimersProfile("Timers", Timers);)      //The whole pass, callbacks included
+
     /**Simple Timer Implementation
      **/
     class Timer : public RepeatableTask {
-        using TimeT = uint32_t;
+        friend TimerController;
+        int slot = -1;          //Index in the schedule
     public:
-        Lambda<void(Timer &)> callback;
-        TimeDecay<> decay;
+        using TimeT = uint32_t;
+        InlineLambda<void(Timer &)> callback;
+        TimerController::TimeT deadline = 0;
         TimeT length;
+        uint8_t priority = 0;       //Higher fires first among timers due at the same time
 
         Timer() {}
 
         Timer(bool repeat, TimeT length) : RepeatableTask(repeat), length(length) {}
 
-        Timer(bool repeat, TimeT length, Lambda<void(Timer &)> &callback) : RepeatableTask(repeat), length(length),
-                                                                            callback(callback) {}
+        Timer(bool repeat, TimeT length, InlineLambda<void(Timer &)> callback) : RepeatableTask(repeat), length(length),
+                                                                                 callback(std::move(callback)) {}
+
+        ~Timer() override { Stop(); }
+
+        bool Active() override { return slot != -1; }
 
         void Start() override {
             Reset();
-            Task::Start();
+        }
+
+        void Stop() override {
+            Timers.Remove(this);
         }
 
         /**Reset the internal clock to fire it in the future**/
         void Reset(){
-            decay = Clock.createDecay(length);
+            deadline = Clock64.Millis() + length;
+            Timers.Schedule(this);
+        }
+
+        /**Milliseconds until the timer fires**/
+        TimeT Remaining(){
+            return TimerController::Until(deadline, Clock64.Millis());
         }
 
         TaskReturn Fire() override {
-            if (Clock.hasDecayed(decay))
+            if (TimerController::Due(deadline, Clock64.Millis()))
                 return FireTimerNow();
             return Nothing;
         }
 
         TaskReturn FireTimerNow() {
             callback(*this);
-            if (Repeat)
-                decay = Clock.createDecay(length);
-            return RepeatableTask::Fire();
+            if (Repeat){
+                deadline = Next(Clock64.Millis());          //The same next release as the schedule, a PeriodicTimer stays on its grid
+                Timers.Schedule(this);
+                return Nothing;
+            }
+            Stop();
+            return Disposed;
         }
+
+    protected:
+        /**When a repeating timer fires next after it fired at $now. A plain timer waits its length from now, so it drifts by how late it was**/
+        virtual TimerController::TimeT Next(TimerController::TimeT now){ return now + max<TimeT>(length, 1); }
+    };
+
+    /**Repeating timer released on a fixed grid: start + k * period. It does not drift however late a run is.
+     * A run that starts more than its deadline after its release counts as missed. When it falls a whole period behind
+     * it either runs every missed release back to back (CatchUp) or skips them and keeps to the grid (Skip)**/
+    class PeriodicTimer : public Timer {
+    public:
+        enum Policy : uint8_t{
+            CatchUp = 0,
+            Skip = 1
+        };
+
+        Policy policy;
+        TimeT relative_deadline;            //Milliseconds after a release the run has to start by. 0 for the period
+
+        explicit PeriodicTimer(TimeT period, Policy policy = Skip, TimeT relative_deadline = 0)
+                : Timer(true, period), policy(policy), relative_deadline(relative_deadline) {}
+
+        PeriodicTimer(TimeT period, InlineLambda<void(Timer &)> callback, Policy policy = Skip, TimeT relative_deadline = 0)
+                : Timer(true, period, std::move(callback)), policy(policy), relative_deadline(relative_deadline) {}
+
+        inline uint32_t Missed(){ return missed; }
+        inline uint32_t Skipped(){ return skipped; }
+        inline void ResetCounters(){ missed = skipped = 0; }
+
+    protected:
+        uint32_t missed = 0, skipped = 0;
+
+        TimerController::TimeT Next(TimerController::TimeT now) override {
+            auto release = deadline;
+            auto period = (TimerController::TimeT) max<TimeT>(length, 1);
+            if(now > release && now - release > (relative_deadline != 0 ? relative_deadline : period))     //FireTimerNow may run it early
+                missed++;
+            auto next = release + period;
+            if(policy == Skip && next <= now){
+                auto behind = (now - release) / period;
+                skipped += behind;
+                next = release + (behind + 1) * period;
+            }
+            return next;
+        }
+    };
+
+    bool TimerController::Before(Timer* a, Timer* b){
+        if(a->deadline != b->deadline)
+            return a->deadline < b->deadline;
+        if(a->priority != b->priority)
+            return a->priority > b->priority;
+        return a->length < b->length;
+    }
+
+    void TimerController::Place(int slot, Timer* t){
+        heap[slot] = t;
+        t->slot = slot;
+    }
+
+    void TimerController::SiftUp(int slot){
+        auto t = heap[slot];
+        while(slot > 0){
+            int parent = (slot - 1) / 2;
+            if(!Before(t, heap[parent]))
+                break;
+            Place(slot, heap[parent]);
+            slot = parent;
+        }
+        Place(slot, t);
+    }
+
+    void TimerController::SiftDown(int slot){
+        auto t = heap[slot];
+        int size = heap.size();
+        while(true){
+            int child = 2 * slot + 1;
+            if(child >= size)
+                break;
+            if(child + 1 < size && Before(heap[child + 1], heap[child]))
+                child++;
+            if(!Before(heap[child], t))
+                break;
+            Place(slot, heap[child]);
+            slot = child;
+        }
+        Place(slot, t);
+    }
+
+    void TimerController::Schedule(Timer* t){
+        if(!Task::Active())
+            Start();
+        if(t->slot == -1){
+            heap.push_back(t);
+            t->slot = heap.size() - 1;
+        }
+        SiftUp(t->slot);
+        SiftDown(t->slot);
+    }
+
+    void TimerController::Remove(Timer* t){
+        int slot = t->slot;
+        if(slot == -1)
+            return;
+        t->slot = -1;
+        auto last = heap.back();
+        heap.pop_back();
+        if(last == t)
+            return;
+        Place(slot, last);
+        SiftUp(slot);
+        SiftDown(last->slot);
+    }
+
+    uint32_t TimerController::UntilNext(){
+        if(heap.empty())
+            return Never;
+        return Until(heap[0]->deadline, Clock64.Millis());
+    }
+
+    TaskReturn TimerController::Fire(){
+        if(heap.empty())
+            return Nothing;
+        auto now = Clock64.Millis();
+        while(!heap.empty() && Due(heap[0]->deadline, now)){
+            auto t = heap[0];
+            profileOnly(auto due = t->deadline;)                    //Lateness is measured against the deadline that came due
+            if(t->Repeat){                                          //Rescheduled before the callback so it can stop or delete the timer
+                t->deadline = t->Next(now);
+                SiftDown(0);
+            }else
+                Remove(t);
+            profileOnly(auto profile = Profile::Of(t, "Timer"); auto fired = ClockMicros(); auto start = NativeMicros();
+                        profile->Late(fired - min(fired, due * 1000));)
+            t->callback(*t);
+            profileOnly(profile->Run(NativeMicros() - start);)             //The timer may be gone, its profile is not
+        }
+        return Nothing;
+    }
+
+#ifdef SIMPLE_PROFILE
+    TaskReturn Task::Run(Task* t){
+        auto profile = Profile::Of(t);
+        auto start = NativeMicros();
+        auto r = t->Fire();                     //A disposed task may be gone, only its profile is touched after
+        profile->Run(NativeMicros() - start);
+        return r;
+    }
+#endif
+
+    /**Simulated time for host tests. Nothing waits, idling jumps straight to the next deadline so hours of timers
+     * run in milliseconds and always fire in the same order. Use it like this
+     *  VirtualClock sim;
+     *  sim.Install();
+     *  sim.Run(60 * 60 * 1000);        //An hour of Yields
+     * Install it before starting the timers it drives, it does not continue from the native clock**/
+    struct VirtualClock : public ClockSource{
+        uint64_t now = 0;           //Microseconds
+        uint32_t step = 1;          //Milliseconds a pass moves when a task polls every Yield
+
+        ~VirtualClock() override { Uninstall(); }
+
+        uint64_t Micros() override { return now; }
+        void Idle(uint32_t milliseconds) override { now += (uint64_t) milliseconds * 1000; }
+
+        void Install(){
+            if(TimeSource == this)
+                return;
+            previous = TimeSource;
+            TimeSource = this;
+        }
+
+        void Uninstall(){
+            if(TimeSource == this)
+                TimeSource = previous;
+        }
+
+        void Advance(uint64_t milliseconds){ now += milliseconds * 1000; }
+
+        /**Yield until $milliseconds of virtual time passed, jumping from one deadline to the next. Timers due at the end fire too**/
+        void Run(uint64_t milliseconds){
+            auto end = now + milliseconds * 1000;
+            while(now < end){
+                Task::Yield();
+                auto idle = Task::IdleTime();
+                now = min(end, now + (uint64_t) max(idle, step) * 1000);
+            }
+            Task::Yield();              //Timers due right at the end
+        }
+
+    private:
+        ClockSource* previous = nullptr;
     };
 
     void Task::Wait(uint32_t milliseconds) {
-        auto start = NativeMillis();
+        auto start = ClockMillis();
         auto diff = 0;
         while (diff < milliseconds) {
             Yield();
-            diff = NativeMillis() - start;
+            Idle(milliseconds - diff);
+            diff = ClockMillis() - start;
         }
     }
+
+    void Task::Idle(uint32_t limit) {
+        if(duty_since == 0)
+            ResetDutyCycle();
+        auto idle = min(IdleTime(), limit);
+        if(idle == 0)
+            return;
+        auto start = ClockMicros();
+        ClockIdle(idle);
+        duty_idle += ClockMicros() - start;
+    }
+
+    float Task::DutyCycle() {
+        auto elapsed = ClockMicros() - duty_since;
+        return elapsed > 0 ? 1 - (float) duty_idle / elapsed : 1;
+    }
+
+    void Task::ResetDutyCycle() {
+        duty_since = ClockMicros();
+        duty_idle = 0;
+    }
 }
 
 #endif
\ No newline at end of file
@@ -16,6 +16,10 @@
 #include "../SimpleTimer.hpp"
 #include "../SimpleConnection.hpp"
 
+#ifdef __AVR__
+    #include <avr/sleep.h>
+#endif
+
 using namespace Simple;
 
 namespace Simple{
@@ -23,37 +27,118 @@ namespace Simple{
         return millis();
     }
 
+    /**micros() wraps every 71 minutes. Yield reads the clock far more often than that. Not for use from interrupts**/
+    uint64_t NativeMicros(){
+        static TickExtender ticks;
+        return ticks.Extend(micros());
+    }
+
+    /**Mask interrupts and return the mask to put back. Boards without a known mask register assume they were on**/
+    uint32_t NativeInterruptsOff(){
+#if defined(__arm__)
+        uint32_t state = __get_PRIMASK();
+        __disable_irq();
+        return state;
+#elif defined(__AVR__)
+        uint8_t state = SREG;
+        cli();
+        return state;
+#elif defined(__MSP430__)
+        uint16_t state = __get_interrupt_state();
+        __disable_interrupt();
+        return state;
+#else
+        noInterrupts();
+        return 0;
+#endif
+    }
+
+    void NativeInterruptsRestore(uint32_t state){
+#if defined(__arm__)
+        __set_PRIMASK(state);
+#elif defined(__AVR__)
+        SREG = state;
+#elif defined(__MSP430__)
+        __set_interrupt_state(state);
+#else
+        interrupts();
+#endif
+    }
+
+    /**The interrupt that posts wakes the device by itself**/
+    void NativeWake(){}
+
+    /**One core, the holder is an interrupt that runs to the end anyway**/
+    void NativeSpinWait(){}
+
+    /**Sleep until the next interrupt. The millisecond tick wakes it at the latest so the loop rechecks the deadline**/
+    void NativeIdle(uint32_t){
+#if defined(__arm__)
+        __WFI();
+#elif defined(__AVR__)
+        set_sleep_mode(SLEEP_MODE_IDLE);
+        sleep_mode();
+#endif
+    }
+
     /**Wrapper of a Arduino Stream to an IO**/
-    struct StreamIO : public IO{
+    struct StreamIO : public StaticIO<StreamIO>{
         Stream& uart;
         explicit StreamIO(Stream& uart = Serial) : uart(uart){}
-        int WriteByte(uint8_t b) { return uart.write(b); }
+        int WriteByte(uint8_t b) final { return uart.write(b); }
         int WriteBytes(uint8_t *ptr, int nbytes) final { return uart.write((uint8_t*) ptr, nbytes); }
-        int ReadByte() { return uart.read(); }
+        int WriteBytesV(IOSlice* slices, int count) final {
+            int written = 0;
+            for(int i = 0; i < count; i++)
+                written += uart.write(slices[i].ptr, slices[i].nbytes);
+            return written;
+        }
+        int ReadByte() final { return uart.read(); }
         int ReadBytesUnlocked(uint8_t *ptr, int buffer_size) final { return uart.readBytes((char*) ptr, buffer_size); }
         int BytesAvailable() final { return uart.available(); }
     };
 
-    StreamIO Out, Error;
+    void NativeInitializeIO(){}
+    int NativeBytesAvailable(FILE*){ return 0; }
+
+    StreamIO SerialOut;
+    BufferedIO Out(SerialOut, 64, FlushOnNewline | FlushOnYield);      //One uart write per line instead of one per Printf piece
+    StreamIO Error;
 
-    /**Wrapper of a Arduino Serial Port to an IO**/
+    /**Wrapper of a Arduino Serial Port to an IO. Incoming bytes are pushed straight into a ring and decoded in place**/
     struct SerialConnection : public Connection{
-        Packet p;
+        IORing ring;
+        Packet p;       //Window over the readable part of the ring
 
-        explicit SerialConnection(int capacity = 256) : p(capacity){}
+        explicit SerialConnection(int capacity = 256) : ring(capacity), p(ring.Memory(), ring.Capacity()){}
 
         TaskReturn Fire() override{
-            while(Serial.available() > 0){
-                p.SeekStart();
-                int nbytes = Serial.readBytes((char*) p.Interpret(0), p.Capacity());
-                auto ps = p.Size();
-
-                p.SetSize(nbytes);
-                Receive(&p);
-                p.SetSize(ps);
-            }
+            uint8_t* span;
+            size_t n;
+            int available;
+
+            do{
+                while((available = Serial.available()) > 0 && (n = ring.WriteSpan(&span)) > 0)
+                    ring.Produce(Serial.readBytes((char*) span, min((size_t) available, n)));
+
+                while((n = ring.Peek(&span)) > 0){
+                    p.Restore({(size_t) (span - ring.Memory().get()), 0, n});
+                    Receive(&p);
+                    ring.SeekDelta(n);
+                    ring.ClearToPosition();
+                }
+            }while(Serial.available() > 0);
+
             return TaskReturn::Nothing;
         }
+
+        /**The uart receive interrupt wakes the device**/
+        uint32_t IdleFor() override { return Serial.available() > 0 ? 0 : Never; }
+
+        void WriteV(IOSlice* slices, int count) override {
+            for(int i = 0; i < count; i++)
+                Serial.write(slices[i].ptr, slices[i].nbytes);
+        }
     protected:
         void Write(IO* io) override {
             uint8_t buf[128];
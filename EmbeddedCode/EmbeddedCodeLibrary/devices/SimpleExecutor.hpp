@@ -0,0 +1,336 @@
+/**********************************************************************
+   NAME: SimpleExecutor.hpp
+   AUTHOR: Johnathan Bizzano
+   DATE: 10/17/2026
+
+    The Simple Project
+		Medium Level (from Low) library that abstracts away from embedded device hardware
+
+    Simple Executor
+        Runs Tasks on a pool of PC threads. Each thread has its own queues and idle threads steal from the
+        others. Connections stay on one thread so a port is never driven from two threads. The Task list that
+        Yield walks (and the Timers on it) stays single threaded, tasks started here must not also be started there
+*********************************************************************/
+
+#ifndef SIMPLE_EXECUTOR_H
+#define SIMPLE_EXECUTOR_H
+
+#include "SimplePC.hpp"
+#include "../SimpleConnection.hpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <deque>
+#include <queue>
+#include <memory>
+#include <atomic>
+#include <limits>
+
+namespace Simple{
+    /**Runs tasks and async callbacks on a pool of threads. A firing only touches the worker queues (short spinlocks)
+     * and a few atomics. The executor lock is taken to start or stop a task, to put a task to sleep or wake it and
+     * when a worker runs out of work**/
+    struct Executor{
+        static constexpr int AnyThread = -1;
+
+        explicit Executor(int threads = max(1, (int) thread::hardware_concurrency())){
+            for(int i = 0; i < threads; i++)
+                workers.emplace_back(new Worker());
+            for(int i = 0; i < threads; i++)
+                workers[i]->runner = thread(&Executor::Work, this, i);
+        }
+
+        /**Tasks still started are dropped, not fired again. The executor does not own them**/
+        ~Executor(){
+            quit.store(true);
+            {
+                lock_guard<mutex> g(lock);
+                wake.notify_all();
+            }
+            for(auto& w : workers)
+                w->runner.join();
+            lock_guard<mutex> g(lock);
+            for(auto& t : tasks)
+                t.second->stopped.store(true);
+            tasks.clear();
+        }
+
+        inline int Threads(){ return workers.size(); }
+
+        /**Fire $t over and over until it is stopped or returns Disposed. Safe from any thread.
+         * Connections are kept on one thread ($home or picked round robin). Other tasks go wherever there is a free thread**/
+        void Start(Task* t, int home = AnyThread){
+            lock_guard<mutex> g(lock);
+            if(tasks.count(t) != 0)
+                return;
+            if(home == AnyThread && dynamic_cast<Connection*>(t) != nullptr)
+                home = next_home++ % Threads();
+            auto e = make_shared<Entry>(t, home);
+            tasks[t] = e;
+            Push(Job{e, Lambda<void()>()}, home, AnyThread);
+            Wake(home);
+        }
+
+        /**Stop firing $t. When it returns $t is not running on any thread and can be deleted. Safe from any thread, including from $t.
+         * A task that deletes itself in Fire must return Disposed instead**/
+        void Stop(Task* t){
+            unique_lock<mutex> g(lock);
+            auto it = tasks.find(t);
+            if(it == tasks.end())
+                return;
+            auto e = it->second;
+            tasks.erase(it);
+            e->stopped.store(true);         //Its queued or sleeping firing is dropped when it comes up
+            if(e.get() != Current())
+                changed.wait(g, [&]{ return !e->running.load(); });
+            changed.notify_all();
+        }
+
+        bool Active(Task* t){
+            lock_guard<mutex> g(lock);
+            return tasks.count(t) != 0;
+        }
+
+        /**Run $callback once on any thread**/
+        void Async(Lambda<void()> callback){
+            Push(Job{nullptr, std::move(callback)}, AnyThread, AnyThread);
+            Notify(AnyThread);
+        }
+
+        /**Block until every task has stopped and every async callback ran**/
+        void Drain(){
+            unique_lock<mutex> g(lock);
+            changed.wait(g, [&]{ return tasks.empty() && queued.load() == 0 && running.load() == 0; });
+        }
+
+    private:
+        using Clock = chrono::steady_clock;
+        static constexpr Clock::rep NoneDue = numeric_limits<Clock::rep>::max();
+
+        /**One start of a task. A task started again at the same address gets a new entry, so a stale firing is told apart**/
+        struct Entry{
+            Task* task;
+            int home;
+            atomic<bool> running{false}, stopped{false};
+
+            Entry(Task* task, int home) : task(task), home(home){}
+        };
+
+        struct Job{
+            shared_ptr<Entry> entry;        //nullptr for an async callback
+            Lambda<void()> callback;
+        };
+
+        struct Sleeper{
+            Clock::time_point wake;
+            shared_ptr<Entry> entry;
+            bool operator>(const Sleeper& o) const { return wake > o.wake; }
+        };
+
+        struct Worker{
+            SpinLock lock;
+            deque<Job> shared;              //Any thread may steal from the front
+            deque<Job> pinned;              //Only this thread runs these
+            atomic<int> pinned_count{0};
+            thread runner;
+        };
+
+        vector<unique_ptr<Worker>> workers;
+        mutex lock;                         //Guards tasks, sleepers and next_home, and is what idle workers wait on
+        condition_variable wake, changed;
+        unordered_map<Task*, shared_ptr<Entry>> tasks;
+        priority_queue<Sleeper, vector<Sleeper>, greater<Sleeper>> sleepers;
+        int next_home = 0;
+        atomic<int> next_shared{0}, queued{0}, shared_queued{0}, running{0}, idle{0};
+        atomic<Clock::rep> next_due{NoneDue};
+        atomic<bool> quit{false};
+
+        /**The entry firing on this thread, so a task can stop itself**/
+        static Entry*& Current(){
+            static thread_local Entry* current = nullptr;
+            return current;
+        }
+
+        /**Queue a job on $home, or on the shared queue of $self (round robin if AnyThread). Return how many shared jobs
+         * that queue now holds. The counts go up before the job is visible, so Take never brings them below zero**/
+        size_t Push(Job job, int home, int self){
+            queued++;
+            if(home != AnyThread){
+                auto& w = *workers[home];
+                w.pinned_count++;
+                Guard<SpinLock> g(w.lock);
+                w.pinned.push_back(std::move(job));
+                return 0;
+            }
+            shared_queued++;
+            auto& w = *workers[self != AnyThread ? self : next_shared++ % Threads()];
+            Guard<SpinLock> g(w.lock);
+            w.shared.push_back(std::move(job));
+            return w.shared.size();
+        }
+
+        /**Wake idle workers for a job queued on $home. Called with the lock held**/
+        void Wake(int home){
+            if(home != AnyThread) wake.notify_all();
+            else wake.notify_one();
+        }
+
+        /**Wake idle workers for a job queued on $home, if there are any. Called without the lock. A worker counts itself
+         * idle before it checks the queue counts, and Push counts the job before this checks idle, so no wake is lost**/
+        void Notify(int home){
+            if(idle.load() == 0)
+                return;
+            lock_guard<mutex> g(lock);
+            Wake(home);
+        }
+
+        /**Take a job for worker $i: its pinned queue, then the back of its shared queue, then the front of another's**/
+        bool Take(int i, Job* job){
+            auto& self = *workers[i];
+            bool pinned = false, found = false;
+            {
+                Guard<SpinLock> g(self.lock);
+                if(!self.pinned.empty()){
+                    *job = std::move(self.pinned.front());
+                    self.pinned.pop_front();
+                    pinned = found = true;
+                }else if(!self.shared.empty()){
+                    *job = std::move(self.shared.back());
+                    self.shared.pop_back();
+                    found = true;
+                }
+            }
+            for(int n = 1; !found && n < Threads(); n++){
+                auto& victim = *workers[(i + n) % Threads()];
+                Guard<SpinLock> g(victim.lock);
+                if(!victim.shared.empty()){
+                    *job = std::move(victim.shared.front());
+                    victim.shared.pop_front();
+                    found = true;
+                }
+            }
+            if(!found)
+                return false;
+
+            running++;                      //Before queued drops, so Drain never sees both at zero while a job moves
+            if(pinned) self.pinned_count--;
+            else shared_queued--;
+            queued--;
+            return true;
+        }
+
+        /**Mark $e as no longer firing. Return if it was stopped, then Stop may be waiting on it**/
+        bool Release(Entry& e){
+            e.running.store(false);
+            if(!e.stopped.load())
+                return false;
+            lock_guard<mutex> g(lock);
+            changed.notify_all();
+            return true;
+        }
+
+        void Execute(int i, Job& job){
+            if(!job.entry){
+                job.callback();
+                job.callback = Lambda<void()>();
+                Finished();
+                return;
+            }
+
+            auto& e = *job.entry;
+            e.running.store(true);          //Stop sets stopped then reads running, this does the reverse, so one sees the other
+            if(e.stopped.load()){
+                Release(e);
+                Finished();
+                return;
+            }
+
+            Current() = &e;
+            bool disposed = e.task->Fire() != TaskReturn::Nothing;      //A disposed task may be gone already
+            Current() = nullptr;
+
+            if(disposed){
+                e.running.store(false);
+                lock_guard<mutex> g(lock);
+                e.stopped.store(true);
+                auto it = tasks.find(e.task);
+                if(it != tasks.end() && it->second == job.entry)
+                    tasks.erase(it);
+                changed.notify_all();
+            }else{
+                uint32_t sleep = e.stopped.load() ? 0 : e.task->IdleFor();     //Still running, so nobody can delete it yet
+                sleep = min(sleep, Task::IdleLimit);        //Nothing here watches IdleWatch or NativeWake, like Task::Idle
+                if(!Release(e)){
+                    if(sleep == 0){
+                        if(Push(std::move(job), e.home, i) > 1)
+                            Notify(AnyThread);              //This worker has a backlog an idle one could steal
+                    }else Sleep(std::move(job.entry), sleep);
+                }
+            }
+            Finished();
+        }
+
+        void Finished(){
+            if(running.fetch_sub(1) == 1 && queued.load() == 0){
+                lock_guard<mutex> g(lock);
+                changed.notify_all();
+            }
+        }
+
+        void Sleep(shared_ptr<Entry> e, uint32_t milliseconds){
+            auto at = Clock::now() + chrono::milliseconds(milliseconds);
+            lock_guard<mutex> g(lock);
+            sleepers.push(Sleeper{at, std::move(e)});
+            if(at.time_since_epoch().count() < next_due.load()){
+                next_due.store(at.time_since_epoch().count());
+                wake.notify_all();          //Idle workers wait for the old first sleeper, have them wait for this one
+            }
+        }
+
+        /**Requeue the sleepers that are due. Only takes the lock when one is**/
+        void WakeSleepers(){
+            auto due = next_due.load();
+            if(due == NoneDue || Clock::now().time_since_epoch().count() < due)
+                return;
+            lock_guard<mutex> g(lock);
+            auto now = Clock::now();
+            bool woke = false;
+            while(!sleepers.empty() && sleepers.top().wake <= now){
+                auto e = sleepers.top().entry;
+                sleepers.pop();
+                if(!e->stopped.load()){
+                    Push(Job{e, Lambda<void()>()}, e->home, AnyThread);
+                    woke = true;
+                }
+            }
+            next_due.store(sleepers.empty() ? NoneDue : sleepers.top().wake.time_since_epoch().count());
+            if(woke)
+                wake.notify_all();
+        }
+
+        /**Wait for a job, the next sleeper or quit, but not longer than Task::IdleLimit**/
+        void Idle(int i){
+            unique_lock<mutex> g(lock);
+            idle++;
+            auto until = Clock::now() + chrono::milliseconds(Task::IdleLimit);
+            auto due = next_due.load();
+            if(due != NoneDue)
+                until = min(until, Clock::time_point(Clock::duration(due)));
+            wake.wait_until(g, until, [&]{ return quit.load() || shared_queued.load() > 0 || workers[i]->pinned_count.load() > 0; });
+            idle--;
+        }
+
+        void Work(int i){
+            while(!quit.load()){
+                WakeSleepers();
+                Job job;
+                if(Take(i, &job))
+                    Execute(i, job);
+                else Idle(i);
+            }
+        }
+    };
+}
+
+#endif
@@ -86,10 +86,10 @@ namespace Simple{
             return true;
         }
 
-        void Send(Packet* p) override{
+        bool Send(Packet* p) override{
             rf95.setHeaderTo(((RadioPacket*) p)->to);
             rf95.setHeaderId(((RadioPacket*) p)->id);
-            Write(p);
+            return rf95.send(p->Begin(), p->BytesAvailable());     //Packets are already contiguous
         }
 
         void Write(IO* in) final {
@@ -97,6 +97,14 @@ namespace Simple{
             rf95.send(buffer.Interpret(0), buffer.ReadFrom(*in));
         }
 
+        /**The radio only takes one contiguous buffer, so the slices are gathered once straight into it**/
+        void WriteV(IOSlice* slices, int count) final {
+            buffer.Clear();
+            for(int i = 0; i < count; i++)
+                buffer.WriteBytes(slices[i].ptr, slices[i].nbytes);
+            rf95.send(buffer.Interpret(0), buffer.Size());
+        }
+
         TaskReturn Fire() override{
             if(rf95.available()){
                 uint8_t len = RH_RF95_MAX_MESSAGE_LEN;
@@ -110,6 +118,9 @@ namespace Simple{
             }
             return TaskReturn::Nothing;
         }
+
+        /**The radio's DIO0 interrupt wakes the device when a packet comes in or a send finishes**/
+        uint32_t IdleFor() override { return rf95.available() ? 0 : Never; }
         void SetAddress(int id){ rf95.setThisAddress(id); }
         void Receive(Packet* p) final { Receive((RadioPacket*) p); }
         virtual void Receive(RadioPacket* rp) = 0;
@@ -15,19 +15,199 @@
 
 #include "../SimpleIO.hpp"
 #include "../SimpleTimer.hpp"
+#include "../SimpleLock.hpp"
+#include "../SimpleConnection.hpp"
 #include <chrono>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <poll.h>
+    #include <sys/ioctl.h>
+    #include <unistd.h>
+    #include <fcntl.h>
+#endif
 
 using namespace std;
 using namespace std::chrono;
 using namespace Simple;
 
 time_t Simple::NativeMillis(){
-    return duration_cast<milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    return duration_cast<milliseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t Simple::NativeMicros(){
+    return duration_cast<microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**There are no interrupts to mask on the PC**/
+uint32_t Simple::NativeInterruptsOff(){ return 0; }
+void Simple::NativeInterruptsRestore(uint32_t){}
+
+void Simple::NativeSpinWait(){ this_thread::yield(); }
+
+/**stdin is made unbuffered so every byte not read yet is still in the descriptor, where NativeBytesAvailable counts it**/
+void Simple::NativeInitializeIO(){
+    setvbuf(stdin, nullptr, _IONBF, 0);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+/**Bytes waiting in descriptor $fd, without blocking**/
+static int DescriptorBytesAvailable(int fd){
+    pollfd p = {fd, POLLIN, 0};
+    int pending = 0;
+    if(poll(&p, 1, 0) > 0 && (p.revents & POLLIN) && ioctl(fd, FIONREAD, &pending) == 0)
+        return pending;
+    return 0;
 }
+#endif
 
-FileIO Out(stdout, stdin);
+/**Bytes waiting in the descriptor of $in. InitializeIO keeps stdin unbuffered so nothing hides in the FILE buffer**/
+int Simple::NativeBytesAvailable(FILE* in){
+#if defined(__unix__) || defined(__APPLE__)
+    return DescriptorBytesAvailable(fileno(in));
+#else
+    return 0;
+#endif
+}
+
+/**A terminal gets each line as it is printed. Piped or redirected output is written once per Yield pass, like stdio
+ * buffers it fully when it is not a terminal**/
+static uint8_t ConsolePolicy(){
+#if defined(__unix__) || defined(__APPLE__)
+    if(!isatty(fileno(stdout)))
+        return FlushOnYield;
+#endif
+    return FlushOnNewline | FlushOnYield;
+}
+
+FileIO StdOut(stdout, stdin);
+BufferedIO Out(StdOut, 4096, ConsolePolicy());
 FileIO Error(stderr, nullptr);
 
+#if defined(__unix__) || defined(__APPLE__)
+/**Descriptors that wake the idle sleep as soon as they can be read. Use it like this
+ *  IdleWatch.push_back({fileno(stdin), POLLIN, 0}); **/
+vector<pollfd> IdleWatch;
+
+/**Self pipe in IdleWatch that NativeWake writes to. At most one byte is in it between two idles**/
+struct IdleWaker{
+    int fds[2] = {-1, -1};
+    std::atomic<bool> pending{false};
+
+    IdleWaker(){
+        if(pipe(fds) != 0)
+            return;
+        fcntl(fds[0], F_SETFL, O_NONBLOCK);
+        fcntl(fds[1], F_SETFL, O_NONBLOCK);
+        IdleWatch.push_back({fds[0], POLLIN, 0});
+    }
+} Waker;
+
+void Simple::NativeIdle(uint32_t milliseconds){
+    poll(IdleWatch.data(), IdleWatch.size(), (int) milliseconds);
+    uint8_t drain[16];
+    while(read(Waker.fds[0], drain, sizeof(drain)) > 0);
+    Waker.pending.store(false, memory_order_seq_cst);       //Cleared after draining, so a later wake writes a byte that stays
+}
+
+void Simple::NativeWake(){
+    if(!Waker.pending.load(memory_order_relaxed) && !Waker.pending.exchange(true, memory_order_seq_cst)){
+        uint8_t b = 1;
+        if(write(Waker.fds[1], &b, 1) < 0)
+            Waker.pending.store(false, memory_order_relaxed);
+    }
+}
+
+/**Connection over a descriptor (a tty, pipe or socket). Incoming bytes are read straight into a ring and decoded in place.
+ * While it is started its descriptor is in IdleWatch, so the loop sleeps until bytes come in. It stops itself when the
+ * other end hangs up. Use it like this
+ *  struct Link : public SerialConnection{ ... void Receive(Packet* p) override { ... } };
+ *  Link link(256, open("/dev/ttyUSB0", O_RDWR | O_NOCTTY)); **/
+struct SerialConnection : public Connection{
+    IORing ring;
+    Packet p;       //Window over the readable part of the ring
+    int fd;
+
+    explicit SerialConnection(int capacity = 256, int fd = STDIN_FILENO) : ring(capacity), p(ring.Memory(), ring.Capacity()), fd(fd){}
+    ~SerialConnection() override { Stop(); }       //~Task cannot reach this Stop
+
+    void Start() override {
+        if(!Active())
+            IdleWatch.push_back({fd, POLLIN, 0});
+        Connection::Start();
+    }
+
+    void Stop() override {
+        if(Active())
+            for(auto w = IdleWatch.begin(); w != IdleWatch.end(); w++)
+                if(w->fd == fd){
+                    IdleWatch.erase(w);
+                    break;
+                }
+        Connection::Stop();
+    }
+
+    TaskReturn Fire() override{
+        uint8_t* span;
+        size_t n;
+        int available;
+
+        do{
+            while((available = DescriptorBytesAvailable(fd)) > 0 && (n = ring.WriteSpan(&span)) > 0){
+                auto got = read(fd, span, min((size_t) available, n));
+                if(got <= 0)
+                    break;
+                ring.Produce(got);
+            }
+
+            while((n = ring.Peek(&span)) > 0){
+                p.Restore({(size_t) (span - ring.Memory().get()), 0, n});
+                Receive(&p);
+                ring.SeekDelta(n);
+                ring.ClearToPosition();
+            }
+        }while(DescriptorBytesAvailable(fd) > 0);
+
+        pollfd end = {fd, POLLIN, 0};
+        if(poll(&end, 1, 0) > 0 && DescriptorBytesAvailable(fd) == 0)
+            Stop();         //Readable with nothing to read is the end of the stream, it would keep waking the idle sleep
+        return TaskReturn::Nothing;
+    }
+
+    /**IdleWatch wakes the loop when bytes come in**/
+    uint32_t IdleFor() override { return Never; }
+
+    void WriteV(IOSlice* slices, int count) override {
+        for(int i = 0; i < count; i++)
+            WriteAll(slices[i].ptr, slices[i].nbytes);
+    }
+protected:
+    void Write(IO* io) override {
+        uint8_t buf[128];
+        int nbytes = 0;
+        while((nbytes = io->ReadBytesUnlocked(buf, 128)) > 0)
+            WriteAll(buf, nbytes);
+    }
+
+    void WriteAll(const uint8_t* ptr, int nbytes){
+        while(nbytes > 0){
+            auto n = write(fd, ptr, nbytes);
+            if(n <= 0)
+                return;
+            ptr += n;
+            nbytes -= n;
+        }
+    }
+};
+#else
+void Simple::NativeIdle(uint32_t milliseconds){
+    this_thread::sleep_for(chrono::milliseconds(milliseconds));
+}
+
+/**Without a pipe to poll the sleep runs out on its own, at most Task::IdleLimit**/
+void Simple::NativeWake(){}
+#endif
+
 
 
 #endif //SANDBOX_SIMPLEPC_H
@@ -0,0 +1,1051 @@
+/**********************************************************************
+   NAME: bench.hpp
+   AUTHOR: Johnathan Bizzano
+   DATE: 10/17/2026
+
+    The Simple Project
+		Medium Level (from Low) library that abstracts away from embedded device hardware
+
+    Sandbox Benchmarks
+		Host benchmarks for the hot paths of the library. Run with "sandbox bench"
+*********************************************************************/
+
+#ifndef SANDBOX_BENCH_H
+#define SANDBOX_BENCH_H
+
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <thread>
+#include "../SimpleConnection.hpp"
+#include "../SimpleLog.hpp"
+#include "../devices/SimpleExecutor.hpp"
+
+using namespace Simple;
+
+/**Time $iterations runs of $f and return the nanoseconds per run**/
+template<typename F> double bench_ns(int iterations, F f){
+    auto start = chrono::steady_clock::now();
+    for(int i = 0; i < iterations; i++)
+        f();
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / iterations;
+}
+
+/**Receive path of SimpleConnection before the streaming decoder. Kept for comparison**/
+struct LegacyFrameConnection : public SimpleConnection{
+    Packet read_buffer;
+    int frames = 0;
+
+    LegacyFrameConnection() : read_buffer(4096){}
+
+    void Write(IO* io) override {}
+    void ReceivedMessage(Packet* io) override { frames++; }
+
+    void Receive(Packet* io) override {
+        read_buffer.SeekEnd();
+        read_buffer.ReadFrom(*io);
+        read_buffer.SeekStart();
+
+        uint32_t maybe_number = 0;
+
+        while(read_buffer.TryReadStd(&maybe_number) && maybe_number != MAGIC_NUMBER)
+            read_buffer.SeekDelta(-3);   //Read next byte
+
+        uint8_t read_size = 0;
+        if(maybe_number == MAGIC_NUMBER && read_buffer.TryReadStd(&read_size)){
+            auto pos = read_buffer.Position();
+            uint8_t tail = 0;
+
+            if(read_buffer.BytesAvailable() <= read_size) return;  //Original seeked past the end here and spun forever
+            read_buffer.SeekDelta(read_size);
+            if(!read_buffer.TryReadStd(&tail)) return;
+            read_buffer.Seek(pos);
+
+            if(tail == TAIL_MAGIC_NUMBER){
+                auto rbs = read_buffer.Size();
+                read_buffer.SetBytesAvailable(read_size);
+                ReceivedMessage(&read_buffer);
+                read_buffer.SetSize(rbs);
+
+                read_buffer.Seek(pos + read_size + sizeof(TAIL_MAGIC_NUMBER));
+            }
+
+            read_buffer.ClearToPosition();
+        }else
+            read_buffer.ClearToPosition();      //Junk Data
+    }
+};
+
+struct CountingFrameConnection : public SimpleConnection{
+    int frames = 0;
+
+    void Write(IO* io) override {}
+    void ReceivedMessage(Packet* io) override { frames++; }
+};
+
+/**Build a stream of framed gyro sized packets with $junk random bytes between frames**/
+inline IOVector bench_frame_stream(int frames, int payload, int junk){
+    IOVector stream;
+    mt19937 rng(1234);
+    for(int f = 0; f < frames; f++){
+        for(int j = 0; j < junk; j++)
+            stream.WriteByte((uint8_t) (rng() % 0xDE));
+        stream.WriteStd(MAGIC_NUMBER);
+        stream.WriteByte(payload);
+        for(int i = 0; i < payload; i++)
+            stream.WriteByte((uint8_t) rng());
+        stream.WriteByte(TAIL_MAGIC_NUMBER);
+    }
+    return stream;
+}
+
+/**Feed $stream to $c in $chunk sized fragments like a serial port would**/
+inline void bench_feed(Connection& c, IOVector& stream, int chunk){
+    Packet p(chunk);
+    for(size_t off = 0; off < stream.Size(); off += chunk){
+        p.Clear();
+        p.WriteBytes(stream.Interpret(off), min((size_t) chunk, stream.Size() - off));
+        p.SeekStart();
+        c.Receive(&p);
+    }
+}
+
+void bench_frame_decoder(){
+    const int frames = 2000;
+    println("Frame Decoder (%i frames, ns per frame)", frames);
+    for(int junk : {0, 16}){
+        auto stream = bench_frame_stream(frames, 12, junk);
+        for(int chunk : {1, 4, 16, 64}){
+            LegacyFrameConnection legacy;
+            CountingFrameConnection streaming;
+            auto legacy_ns = bench_ns(1, [&]{ bench_feed(legacy, stream, chunk); }) / frames;
+            auto streaming_ns = bench_ns(1, [&]{ bench_feed(streaming, stream, chunk); }) / frames;
+            println("\tJunk=%i Chunk=%i: Legacy=%d (%i frames) Streaming=%d (%i frames)",
+                    junk, chunk, legacy_ns, legacy.frames, streaming_ns, streaming.frames);
+        }
+    }
+}
+
+/**Stream bytes through an IORing from a producer thread to a consumer thread and check nothing got lost or reordered**/
+void bench_ring(){
+    const size_t total = 16 * 1024 * 1024;
+    println("IORing SPSC Stress (%U MiB)", (unsigned long) (total >> 20));
+    for(size_t capacity : {64, 1024, 16384}){
+        IORing ring(capacity);
+        bool ok = true;
+
+        auto ns = bench_ns(1, [&]{
+            thread producer([&]{
+                mt19937 rng(42);
+                uint8_t chunk[256];
+                size_t sent = 0;
+                while(sent < total){
+                    auto n = min((size_t) (rng() % sizeof(chunk)) + 1, total - sent);
+                    for(size_t i = 0; i < n; i++)
+                        chunk[i] = (uint8_t) (sent + i);
+                    size_t written = 0;
+                    while(written < n){
+                        auto w = ring.WriteBytes(chunk + written, n - written);
+                        if(w == 0)
+                            this_thread::yield();       //Full. Let the consumer run if they share a core
+                        written += w;
+                    }
+                    sent += n;
+                }
+            });
+
+            size_t received = 0;
+            while(received < total){
+                uint8_t* span;
+                auto n = ring.Peek(&span);
+                if(n == 0)
+                    this_thread::yield();
+                for(size_t i = 0; i < n; i++)
+                    ok &= span[i] == (uint8_t) (received + i);
+                ring.Commit(n);
+                received += n;
+            }
+            producer.join();
+        });
+
+        println("\tCapacity=%U: %d MiB/s %s", (unsigned long) capacity, (total / (1024.0 * 1024.0)) / (ns / 1E9), ok ? "Ok" : "CORRUPTED");
+    }
+}
+
+/**Compare the bytes and time of text prints against binary logs and decode them back through the format table of the sandbox**/
+void bench_log(){
+    //Copy the table out of our own elf the way a host tool does for a firmware
+    vector<char> formats;
+    char exe[512], command[640];
+    auto n = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    exe[max(n, (ssize_t) 0)] = '\0';
+    snprintf(command, sizeof(command), "objcopy --dump-section .simple_log=/tmp/sandbox_formats.bin '%s' /dev/null", exe);
+    if(n > 0 && system(command) == 0){
+        ifstream file("/tmp/sandbox_formats.bin", ios::binary);
+        formats.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    }
+    LogTable table(formats.data(), formats.data() + formats.size());
+    println("Binary Log (%i byte format table, %i collisions)", (int) formats.size(), table.Collisions());
+
+    IOVector text, log, decoded;
+    const int iterations = 100000;
+    auto text_ns = bench_ns(iterations, [&]{
+        text.Clear();
+        text.Printf(SimpleFormat("[Tx]:" "Gyro %f Speed %i" "\r\n"), -12.5f, 1200);
+        text.Printf(SimpleFormat("[Tx]:" "Packet %u of %U from %s" "\r\n"), 42u, 1000ul, "Txer");
+        text.Printf(SimpleFormat("[Tx]:" "LoRa Radio Okay!" "\r\n"));
+    });
+    auto log_ns = bench_ns(iterations, [&]{
+        log.Clear();
+        Log::Write(log, SimpleFormat("[Tx]:" "Gyro %f Speed %i" "\r\n"), -12.5f, 1200);
+        Log::Write(log, SimpleFormat("[Tx]:" "Packet %u of %U from %s" "\r\n"), 42u, 1000ul, "Txer");
+        Log::Write(log, SimpleFormat("[Tx]:" "LoRa Radio Okay!" "\r\n"));
+    });
+
+    log.SeekStart();
+    bool ok = true;
+    for(int i = 0; i < 3; i++)
+        ok &= table.Decode(log, decoded);
+    ok &= decoded.Size() == text.Size() && memcmp(decoded.Interpret(0), text.Interpret(0), text.Size()) == 0;
+
+    println("\tText=%U bytes %d ns  Log=%U bytes %d ns  Round Trip %s",
+            (unsigned long) text.Size(), text_ns, (unsigned long) log.Size(), log_ns, ok ? "Ok" : "MISMATCH");
+}
+
+/**Compare Convert against snprintf on random integers and doubles and check every double reads back the same**/
+void bench_convert(){
+    const int count = 100000;
+    mt19937_64 rng(7);
+    vector<uint64_t> ints(count);
+    vector<double> doubles(count);
+    for(int i = 0; i < count; i++){
+        ints[i] = rng() >> (rng() % 64);
+        doubles[i] = (double) (int64_t) rng() / (double) (rng() | 1);
+    }
+
+    char buffer[Convert::BufferSize];
+    volatile int sink = 0;
+    size_t i = 0;
+    auto int_ns = bench_ns(count, [&]{ sink += Convert::UInt64(buffer, ints[i++ % count]); });
+    auto int_snprintf_ns = bench_ns(count, [&]{ sink += snprintf(buffer, sizeof(buffer), "%llu", (unsigned long long) ints[i++ % count]); });
+    auto fixed_ns = bench_ns(count, [&]{ sink += Convert::Float64(buffer, doubles[i++ % count], 4); });
+    auto fixed_snprintf_ns = bench_ns(count, [&]{ sink += snprintf(buffer, sizeof(buffer), "%.4f", doubles[i++ % count]); });
+    auto shortest_ns = bench_ns(count, [&]{ sink += Convert::Float64(buffer, doubles[i++ % count]); });
+    auto shortest_snprintf_ns = bench_ns(count, [&]{ sink += snprintf(buffer, sizeof(buffer), "%.17g", doubles[i++ % count]); });
+
+    int mismatches = 0;
+    for(double d : doubles){
+        Convert::Float64(buffer, d);
+        mismatches += strtod(buffer, nullptr) != d;
+    }
+
+    println("Number Formatting (ns per number)");
+    println("\tUInt64: Convert=%d snprintf=%d", int_ns, int_snprintf_ns);
+    println("\tFloat64 Fixed 4: Convert=%d snprintf=%d", fixed_ns, fixed_snprintf_ns);
+    println("\tFloat64 Shortest: Convert=%d snprintf 17g=%d Round Trip Mismatches=%i", shortest_ns, shortest_snprintf_ns, mismatches);
+}
+
+/**WriteStd of an array before bulk swapping. One reverse and one virtual WriteBytes per element. Kept for comparison**/
+template<typename T> void legacy_write_std(IO& io, const T* a, int count){
+    for(int i = 0; i < count; i++){
+        T v = a[i];
+        std::reverse((uint8_t*) &v, (uint8_t*) &v + sizeof(T));
+        io.WriteBytes((uint8_t*) &v, sizeof(T));
+    }
+}
+
+/**Serialize a 9 axis IMU sample and a large vector both ways and check the wire bytes match**/
+void bench_byte_order(){
+    array<float, 9> imu = {0.1f, -9.81f, 0.02f, 1.5f, -2.25f, 0.0f, 21.0f, -3.5f, 42.0f};
+    vector<uint16_t> samples(4096);
+    for(size_t i = 0; i < samples.size(); i++)
+        samples[i] = (uint16_t) (i * 2654435761u);
+
+    IOVector legacy, bulk;
+    const int iterations = 20000;
+    auto legacy_imu_ns = bench_ns(iterations, [&]{ legacy.Clear(); legacy_write_std(legacy, imu.data(), 9); });
+    auto bulk_imu_ns = bench_ns(iterations, [&]{ bulk.Clear(); bulk.WriteStd(imu); });
+    bool ok = legacy.Size() == bulk.Size() && memcmp(legacy.Interpret(0), bulk.Interpret(0), bulk.Size()) == 0;
+
+    auto legacy_vec_ns = bench_ns(200, [&]{ legacy.Clear(); legacy.WriteStd((uint32_t) samples.size()); legacy_write_std(legacy, samples.data(), (int) samples.size()); });
+    auto bulk_vec_ns = bench_ns(200, [&]{ bulk.Clear(); bulk.WriteStd(samples); });
+    ok &= legacy.Size() == bulk.Size() && memcmp(legacy.Interpret(0), bulk.Interpret(0), bulk.Size()) == 0;
+
+    vector<uint16_t> read_back;
+    bulk.SeekStart();
+    bulk.ReadStd(&read_back);
+    ok &= read_back == samples;
+
+    println("Byte Order (ns per write)");
+    println("\tIMU 9 floats: Legacy=%d Bulk=%d", legacy_imu_ns, bulk_imu_ns);
+    println("\t4096 uint16: Legacy=%d Bulk=%d Wire Match %s", legacy_vec_ns, bulk_vec_ns, ok ? "Ok" : "MISMATCH");
+}
+
+/**Serialize an IMU sample one value at a time through the type erased IO**/
+__attribute__((noinline)) void bench_serialize_erased(IO& io, const float* imu){
+    for(int i = 0; i < 9; i++)
+        io.WriteStd(imu[i]);
+    io.WriteByte(0);
+}
+
+/**Serialize an IMU sample one value at a time with the static type known**/
+__attribute__((noinline)) void bench_serialize_static(Packet& p, const float* imu){
+    for(int i = 0; i < 9; i++)
+        p.WriteStd(imu[i]);
+    p.WriteByte(0);
+}
+
+void bench_static_io(){
+    const float imu[9] = {0.1f, -9.81f, 0.02f, 1.5f, -2.25f, 0.0f, 21.0f, -3.5f, 42.0f};
+    Packet p(64);
+    const int iterations = 200000;
+    auto erased_ns = bench_ns(iterations, [&]{ p.Clear(); bench_serialize_erased(p, imu); });
+    auto static_ns = bench_ns(iterations, [&]{ p.Clear(); bench_serialize_static(p, imu); });
+    println("Static IO (ns per IMU sample into a Packet)");
+    println("\tVirtual=%d Static=%d", erased_ns, static_ns);
+}
+
+/**Port that counts the calls made into it, like the uart driver under a StreamIO**/
+struct CountingIO : public StaticIO<CountingIO>{
+    int calls = 0, bytes = 0;
+
+    int WriteBytes(uint8_t *ptr, int nbytes) final { calls++; bytes += nbytes; return nbytes; }
+    int ReadBytesUnlocked(uint8_t *ptr, int buffer_size) final { return 0; }
+    int BytesAvailable() final { return 0; }
+};
+
+/**Print telemetry lines to a line buffered FILE (like a console) and to a counting port, directly and through a BufferedIO.
+ * Each loop pass prints 8 lines then yields, as a gateway reporting its links would**/
+void bench_buffered_io(){
+    FILE* null = fopen("/dev/null", "w");
+    if(null == nullptr)
+        return;
+    setvbuf(null, nullptr, _IOLBF, BUFSIZ);
+
+    const int iterations = 20000, lines = 8;
+    int i = 0;
+    auto pass = [&](IO& io){
+        for(int n = 0; n < lines; n++)
+            io.Printf(SimpleFormat("Sensor %i: %f %f %f\r\n"), i++, 0.25, -9.81, 1.5);
+        Task::Yield();
+    };
+    double direct_ns, line_ns, yield_ns;
+    {
+        FileIO file(null, nullptr);
+        BufferedIO line_file(file, 256, FlushOnNewline);
+        BufferedIO yield_file(file, 4096, FlushOnYield);
+        direct_ns = bench_ns(iterations, [&]{ pass(file); }) / lines;
+        line_ns = bench_ns(iterations, [&]{ pass(line_file); }) / lines;
+        yield_ns = bench_ns(iterations, [&]{ pass(yield_file); }) / lines;
+    }
+
+    CountingIO port;
+    BufferedIO line_port(port, 64, FlushOnNewline);
+    BufferedIO yield_port(port, 1024, FlushOnYield);
+    pass(port);
+    auto direct_calls = port.calls;
+    port.calls = 0;
+    pass(line_port);
+    auto line_calls = port.calls;
+    port.calls = 0;
+    pass(yield_port);
+    auto yield_calls = port.calls;
+    fclose(null);
+
+    println("Buffered IO (8 lines per Yield)");
+    println("\tConsole ns per line: Direct=%d Newline=%d Yield=%d", direct_ns, line_ns, yield_ns);
+    println("\tPort writes per pass: Direct=%i Newline=%i Yield=%i", direct_calls, line_calls, yield_calls);
+}
+
+/**Timer before the deadline schedule. Every Yield fires it and it reads the clock to see if it is due. Kept for comparison**/
+struct LegacyTimer : public Task{
+    TimeDecay<> decay;
+    uint32_t length;
+
+    explicit LegacyTimer(uint32_t length) : length(length){}
+
+    void Start() override {
+        decay = Clock.createDecay(length);
+        Task::Start();
+    }
+
+    TaskReturn Fire() override {
+        if(Clock.hasDecayed(decay))
+            decay = Clock.createDecay(length);
+        return Nothing;
+    }
+};
+
+/**Cost of a Yield with N long running timers waiting, scanned vs scheduled**/
+void bench_timers(){
+    println("Timers (ns per Yield with N idle timers)");
+    for(int n : {1, 16, 256}){
+        vector<LegacyTimer*> legacy;
+        for(int i = 0; i < n; i++){
+            legacy.push_back(new LegacyTimer(3600000 + i));
+            legacy.back()->Start();
+        }
+        auto legacy_ns = bench_ns(20000, []{ Task::Yield(); });
+        for(auto it = legacy.rbegin(); it != legacy.rend(); it++)
+            delete *it;
+
+        vector<Timer*> timers;
+        for(int i = 0; i < n; i++){
+            timers.push_back(new Timer(true, 3600000 + i));
+            timers.back()->Start();
+        }
+        auto heap_ns = bench_ns(20000, []{ Task::Yield(); });
+        for(auto t : timers)
+            delete t;
+
+        println("\tN=%i: Scan=%d Heap=%d", n, legacy_ns, heap_ns);
+    }
+}
+
+/**Task that does nothing but sit in the list**/
+struct IdleTask : public Task{
+    TaskReturn Fire() override { return Nothing; }
+};
+
+/**Task that stops (and deletes) other tasks from inside Fire, the case that broke index based ids**/
+struct ChurnTask : public Task{
+    vector<Task*>* victims;
+    mt19937* rng;
+
+    ChurnTask(vector<Task*>* victims, mt19937* rng) : victims(victims), rng(rng){}
+
+    TaskReturn Fire() override {
+        if(!victims->empty()){
+            auto i = (*rng)() % victims->size();
+            delete (*victims)[i];
+            (*victims)[i] = victims->back();
+            victims->pop_back();
+        }
+        return Nothing;
+    }
+};
+
+/**Stress the task list: thousands of async tasks and timers started, stopped and deleted while Yield walks the list**/
+void bench_task_churn(){
+    mt19937 rng(7);
+    int base = Task::Count() + (Timers.Active() ? 0 : 1), spawned = 0, ran = 0;     //Timers joins the list with the first timer
+    vector<Task*> victims;
+    vector<Timer*> timers;
+    ChurnTask churn(&victims, &rng);
+    churn.Start();
+
+    auto start = chrono::steady_clock::now();
+    for(int round = 0; round < 2000; round++){
+        for(int i = 0; i < 4; i++, spawned++)
+            Async(make_global_lambda([&ran], void, (), ran++));
+        victims.push_back(new Timer(true, 1000000));
+        victims.back()->Start();
+        victims.push_back(new IdleTask());
+        victims.back()->Start();
+        auto t = new Timer(rng() % 2, rng() % 3);
+        t->callback = make_global_lambda([], void, (Timer& self), self.Stop());
+        t->Start();
+        timers.push_back(t);
+        if(rng() % 3 == 0){
+            auto i = rng() % timers.size();
+            timers[i]->Stop();
+        }
+        Task::Yield();
+    }
+    Task::Yield();
+    auto ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / 2000;
+
+    churn.Stop();
+    for(auto v : victims)
+        delete v;
+    for(auto t : timers)
+        delete t;
+    bool ok = ran == spawned && Task::Count() == base;
+
+    println("Task Churn (2000 rounds of 4 async, 2 timers and an idle task, deleting inside Fire)");
+    println("\tns per round=%d Async Ran %i/%i List %s", ns, ran, spawned, ok ? "Ok" : "CORRUPT");
+}
+
+/**std::mutex with the counters SpinLock and TicketLock keep, for comparison**/
+struct CountingMutex{
+    mutex m;
+    uint32_t acquired = 0, contended = 0;
+
+    void Lock(){
+        if(!m.try_lock()){
+            m.lock();
+            contended++;
+        }
+        acquired++;
+    }
+    void Unlock(){ m.unlock(); }
+    uint32_t Contended(){ return contended; }
+};
+
+/**$threads threads take $lock $total times between them, each bumping a shared counter. Returns ns per acquisition**/
+template<typename L> double bench_lock_contention(L& lock, int threads, int total, bool* ok){
+    vector<thread> workers;
+    uint64_t counter = 0;
+    auto start = chrono::steady_clock::now();
+    for(int t = 0; t < threads; t++)
+        workers.emplace_back([&lock, &counter, threads, total]{
+            for(int i = 0; i < total / threads; i++){
+                Guard<L> g(lock);
+                counter++;
+            }
+        });
+    for(auto& w : workers)
+        w.join();
+    *ok = *ok && counter == (uint64_t) (total / threads) * threads;
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / total;
+}
+
+/**Threads fighting over one lock: std::mutex vs the test and test and set SpinLock vs the fair TicketLock**/
+void bench_locks(){
+    const int total = 200000;
+    bool ok = true;
+    println("Locks (ns per acquisition and percent of them contended, %i hardware threads)", (int) thread::hardware_concurrency());
+    for(int threads : {1, 2, 4, 8}){
+        CountingMutex m;
+        SpinLock spin;
+        TicketLock ticket;
+        auto mutex_ns = bench_lock_contention(m, threads, total, &ok);
+        auto spin_ns = bench_lock_contention(spin, threads, total, &ok);
+        auto ticket_ns = bench_lock_contention(ticket, threads, total / 4, &ok);
+        println("\tThreads=%i Mutex=%d (%d) Spin=%d (%d) Ticket=%d (%d)", threads,
+                mutex_ns, 100.0 * m.Contended() / total, spin_ns, 100.0 * spin.Contended() / total,
+                ticket_ns, 100.0 * ticket.Contended() / (total / 4));
+    }
+    println("\tCounts %s", ok ? "Ok" : "LOST UPDATES");
+}
+
+/**Packet handles from $producers threads to the loop. Each producer cycles through 8 packets of its own**/
+template<typename Q, typename F> double bench_queue_throughput(int producers, int total, Q& queue, int* received, F consume){
+    vector<thread> workers;
+    auto start = chrono::steady_clock::now();
+    for(int t = 0; t < producers; t++)
+        workers.emplace_back([&queue, producers, total]{
+            vector<Simple::ref<Packet>> mine;
+            for(int i = 0; i < 8; i++)
+                mine.push_back(MakeRef<Packet>(Heap, 32));
+            for(int i = 0; i < total / producers; i++){
+                auto p = mine[i % 8];
+                while(!queue.Post(p))
+                    this_thread::yield();
+            }
+        });
+    while(*received < total / producers * producers)
+        consume();
+    for(auto& w : workers)
+        w.join();
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / total;
+}
+
+/**The queue a gateway would have used before: a mutex around a deque. Kept for comparison**/
+struct MutexPacketQueue{
+    mutex lock;
+    deque<Simple::ref<Packet>> packets;
+
+    bool Post(Simple::ref<Packet>& p){
+        lock_guard<mutex> g(lock);
+        packets.push_back(std::move(p));
+        return true;
+    }
+
+    bool Take(Simple::ref<Packet>* out){
+        lock_guard<mutex> g(lock);
+        if(packets.empty())
+            return false;
+        *out = std::move(packets.front());
+        packets.pop_front();
+        return true;
+    }
+};
+
+/**Throughput of the packet queue against a mutex queue with 1 to 8 producer threads. Both consumers give up the core
+ * when they find nothing. Then the latency from Post to the receiver when every packet has to wake the idle loop**/
+void bench_message_queue(){
+    const int total = 200000;
+    println("Message Queue (ns per packet, %i hardware threads)", (int) thread::hardware_concurrency());
+    for(int producers : {1, 2, 4, 8}){
+        int received = 0;
+        PacketQueue<1024> queue([&received](Simple::ref<Packet>&){ received++; });
+        auto queue_ns = bench_queue_throughput(producers, total, queue, &received, [&queue]{
+            Task::Yield();
+            if(queue.Empty())
+                this_thread::yield();
+        });
+
+        int taken = 0;
+        MutexPacketQueue locked;
+        auto mutex_ns = bench_queue_throughput(producers, total, locked, &taken, [&]{
+            Simple::ref<Packet> p;
+            if(locked.Take(&p)) taken++;
+            else this_thread::yield();
+        });
+        println("\tProducers=%i Queue=%d Mutex=%d Full Retries=%i", producers, queue_ns, mutex_ns, queue.Overflows());
+    }
+
+    println("Message Queue Latency (us from Post to receiver, loop idle in between)");
+    for(int producers : {1, 2, 4, 8}){
+        const int each = 200;
+        vector<uint64_t> latency;
+        PacketQueue<64> queue([&latency](Simple::ref<Packet>& p){
+            uint64_t sent = 0;
+            p->SeekStart();
+            p->TryReadStd(&sent);
+            latency.push_back(NativeMicros() - sent);
+        });
+        vector<thread> workers;
+        for(int t = 0; t < producers; t++)
+            workers.emplace_back([&queue]{
+                for(int i = 0; i < each; i++){
+                    this_thread::sleep_for(chrono::microseconds(500));
+                    auto p = MakeRef<Packet>(Heap, 16);
+                    p->WriteStd(NativeMicros());
+                    queue.Post(p);
+                }
+            });
+        while((int) latency.size() < producers * each - (int) queue.Overflows()){
+            Task::Yield();
+            Task::Idle();
+        }
+        for(auto& w : workers)
+            w.join();
+        sort(latency.begin(), latency.end());
+        println("\tProducers=%i Median=%i P99=%i Max=%i Dropped=%i", producers, (int) latency[latency.size() / 2],
+                (int) latency[latency.size() * 99 / 100], (int) latency.back(), queue.Overflows());
+    }
+}
+
+/**Packets of 16 to 200 bytes with 8 in flight, each made, filled and dropped. Then async tasks fired from a pool vs the heap**/
+void bench_allocators(){
+    const int rounds = 200000, in_flight = 8;
+    static Pool<uint8_t[256], 16> packets;
+    static StaticArena<in_flight * 256> scratch;
+    mt19937 rng(11);
+    vector<int> sizes(rounds);
+    for(auto& s : sizes)
+        s = 16 + rng() % 185;
+
+    auto churn = [&](Allocator* from){
+        vector<Packet> window;
+        window.reserve(in_flight);
+        int i = 0;
+        return bench_ns(rounds / in_flight, [&]{
+            Arena::Scope scope(scratch);            //Only rewinds the arena, the others ignore it
+            for(int n = 0; n < in_flight; n++, i++){
+                if(from != nullptr) window.emplace_back(*from, sizes[i]);
+                else window.emplace_back(sizes[i]);
+                window.back().WriteStd((uint32_t) i);
+            }
+            window.clear();
+        }) / in_flight;
+    };
+    auto heap_ns = churn(nullptr);
+    auto pool_ns = churn(&packets);
+    auto arena_ns = churn(&scratch);
+
+    static Pool<AsyncTask, 8> tasks;
+    int ran = 0;
+    auto fire = [&](Allocator& from){
+        return bench_ns(rounds / 4, [&]{
+            for(int n = 0; n < 4; n++)
+                Async([&ran]{ ran++; }, from);
+            Task::Yield();
+        }) / 4;
+    };
+    auto async_heap_ns = fire(Heap);
+    auto async_pool_ns = fire(tasks);
+    for(int n = 0; n < 9; n++)
+        Async([&ran]{ ran++; }, tasks);         //One more than fits
+    Task::Yield();
+
+    println("Allocators (ns per packet made and dropped, 8 in flight)");
+    println("	Heap=%d Pool=%d Arena=%d", heap_ns, pool_ns, arena_ns);
+    println("	Pool High Water=%i/%i Failures=%i Arena High Water=%i/%i Failures=%i", packets.HighWater(), packets.Capacity(),
+            packets.Failures(), (int) scratch.HighWater(), (int) scratch.Capacity(), scratch.Failures());
+    println("	Async ns per task: Heap=%d Pool=%d Task Pool High Water=%i Failures=%i Ran=%i", async_heap_ns, async_pool_ns,
+            tasks.HighWater(), tasks.Failures(), ran);
+}
+
+/**Run the loop for a while with a 5 ms telemetry timer, spinning Task::Yield vs the idle aware Yield**/
+/**Link on one end of a pipe. Remembers when its last byte came in**/
+struct PipeLink : public SerialConnection{
+    uint64_t received = 0;
+
+    explicit PipeLink(int fd) : SerialConnection(64, fd){}
+
+    void Receive(Packet* p) override {
+        p->SeekDelta(p->BytesAvailable());
+        received = NativeMicros();
+    }
+};
+
+/**A gateway idling on a serial link. Count the loop passes while nothing comes in and time how long a byte written from
+ * another thread takes to reach Receive**/
+void bench_idle_link(){
+    int fds[2];
+    if(pipe(fds) != 0)
+        return;
+    PipeLink link(fds[0]);
+    link.Start();
+
+    int passes = 0;
+    auto end = NativeMillis() + 300;
+    while(NativeMillis() < end){
+        Yield();
+        passes++;
+    }
+
+    uint64_t sent = 0;
+    thread writer([&]{
+        this_thread::sleep_for(chrono::milliseconds(20));
+        uint8_t b = 1;
+        sent = NativeMicros();
+        if(write(fds[1], &b, 1) < 0)
+            sent = 0;
+    });
+    end = NativeMillis() + 100;
+    while(link.received == 0 && NativeMillis() < end)
+        Yield();
+    writer.join();
+
+    close(fds[1]);
+    end = NativeMillis() + 100;
+    while(link.Active() && NativeMillis() < end)
+        Yield();
+    auto stopped = !link.Active();
+    close(fds[0]);
+
+    println("\tIdle Link: Loop Passes in 300 ms=%i Byte to Receive us=%U Stopped on Hangup=%s",
+            passes, link.received > sent ? link.received - sent : 0, stopped ? "Yes" : "No");
+}
+
+void bench_idle(){
+    int fired = 0;
+    uint64_t last = 0, worst = 0;        //Largest miss of the 5 ms period in microseconds
+    auto count = make_global_lambda(capture(&fired, &last, &worst), void, (Timer&), {
+        auto now = NativeMicros();
+        if(fired++ > 0){
+            auto period = now - last;
+            worst = max(worst, period > 5000 ? period - 5000 : 5000 - period);
+        }
+        last = now;
+    });
+    Timer telemetry(true, 5, count);
+    telemetry.Start();
+
+    auto run = [&](bool idle){
+        auto cpu = clock();
+        auto end = NativeMillis() + 300;
+        Task::ResetDutyCycle();
+        while(NativeMillis() < end){
+            if(idle) Yield();
+            else Task::Yield();
+        }
+        return 1000.0 * (clock() - cpu) / CLOCKS_PER_SEC;
+    };
+    auto spin_cpu = run(false);
+    auto spin_fired = fired;
+    fired = 0;
+    worst = 0;
+    auto idle_cpu = run(true);
+    auto duty = Task::DutyCycle();
+    telemetry.Stop();
+
+    println("Idle Yield (300 ms with a 5 ms timer)");
+    println("\tCPU ms: Spin=%d Idle=%d Timer Fired %i/%i Duty Cycle=%f", spin_cpu, idle_cpu, spin_fired, fired, duty);
+    println("\tIdle Timer Jitter us: Worst=%U", worst);
+    bench_idle_link();
+}
+
+/**An hour of a transmitter (50 ms gyro, 500 ms packets, 2 s heartbeat) on the virtual clock**/
+void bench_virtual_clock(){
+    int gyro = 0, packets = 0, beats = 0;
+    auto count_gyro = make_global_lambda([&gyro], void, (Timer&), gyro++);
+    auto count_packets = make_global_lambda([&packets], void, (Timer&), packets++);
+    auto count_beats = make_global_lambda([&beats], void, (Timer&), beats++);
+
+    VirtualClock sim;
+    sim.Install();
+    Timer gyroTimer(true, 50, count_gyro), packetTimer(true, 500, count_packets), heartBeat(true, 2000, count_beats);
+    gyroTimer.Start();
+    packetTimer.Start();
+    heartBeat.Start();
+
+    auto start = NativeMicros();
+    sim.Run(60 * 60 * 1000);
+    auto elapsed = NativeMicros() - start;
+    gyroTimer.Stop();
+    packetTimer.Stop();
+    heartBeat.Stop();
+    sim.Uninstall();
+
+    println("Virtual Clock (1 hour with 50 ms, 500 ms and 2 s timers)");
+    println("\tWall ms=%f Fired %i/72000 %i/7200 %i/1800", elapsed / 1000.0, gyro, packets, beats);
+}
+
+/**Stands in for a radio send that now and then blocks the loop for up to 30 ms**/
+struct BlockingRadio : public Task{
+    VirtualClock* sim;
+    mt19937 rng{7};
+
+    explicit BlockingRadio(VirtualClock* sim) : sim(sim){}
+
+    TaskReturn Fire() override {
+        if(rng() % 20 == 0)
+            sim->Advance(rng() % 31);
+        return Nothing;
+    }
+};
+
+/**A 50 ms gyro stream for a minute next to a radio that blocks. Intervals are taken on the virtual clock**/
+void bench_periodic(){
+    struct Stream{
+        uint64_t last = 0;
+        int samples = 0;
+        double sum = 0, sum_sq = 0;
+
+        void Sample(){
+            auto now = Clock64.Micros();
+            if(samples++ > 0){
+                double interval = (now - last) / 1000.0;
+                sum += interval;
+                sum_sq += interval * interval;
+            }
+            last = now;
+        }
+        double Mean(){ return sum / max(samples - 1, 1); }
+        double Deviation(){ return sqrt(max(0.0, sum_sq / max(samples - 1, 1) - Mean() * Mean())); }
+    } drifting, locked;
+
+    VirtualClock sim;
+    sim.Install();
+    BlockingRadio radio(&sim);
+    auto sample_drifting = make_global_lambda([&drifting], void, (Timer&), drifting.Sample());
+    auto sample_locked = make_global_lambda([&locked], void, (Timer&), locked.Sample());
+    Timer timer(true, 50, sample_drifting);
+    PeriodicTimer periodic(50, sample_locked, PeriodicTimer::Skip, 20);
+    radio.Start();
+    timer.Start();
+    periodic.Start();
+    sim.Run(60 * 1000);
+    radio.Stop();
+    timer.Stop();
+    periodic.Stop();
+    sim.Uninstall();
+
+    println("Periodic (50 ms stream for 1 minute, radio blocking up to 30 ms)");
+    println("\tTimer: Samples=%i/1200 Mean ms=%f Deviation ms=%f", drifting.samples, drifting.Mean(), drifting.Deviation());
+    println("\tPeriodic: Samples=%i/1200 Mean ms=%f Deviation ms=%f Missed=%u Skipped=%u",
+            locked.samples, locked.Mean(), locked.Deviation(), periodic.Missed(), periodic.Skipped());
+}
+
+uint32_t defer_ran = 0, defer_worst = 0;
+
+/**A thread stands in for an interrupt posting a call to the loop every 20 us. The loop idles in between**/
+void bench_defer(){
+    static DeferQueue<64> deferred;
+    const uint32_t posts = 2000;
+    atomic<bool> finished(false);
+    thread producer([&]{
+        for(uint32_t i = 0; i < posts; i++){
+            deferred.Post([](uint32_t posted){
+                defer_ran++;
+                defer_worst = max(defer_worst, (uint32_t) NativeMicros() - posted);
+            }, (uint32_t) NativeMicros());
+            this_thread::sleep_for(chrono::microseconds(20));
+        }
+        finished = true;
+    });
+
+    auto start = NativeMicros();
+    while(!finished || !deferred.Empty())
+        Yield();
+    producer.join();
+    auto elapsed = NativeMicros() - start;
+
+    println("Defer Queue (%u posts from another thread, 64 slots)", posts);
+    println("\tRan=%u Dropped=%u Worst Latency us=%u ms=%f", defer_ran, deferred.Overflows(), defer_worst, elapsed / 1000.0);
+}
+
+/**Mix the payload a few rounds like a checksum or decode would**/
+inline uint32_t bench_digest(const uint8_t* data, int n){
+    uint32_t h = 2166136261u;
+    for(int round = 0; round < 32; round++)
+        for(int i = 0; i < n; i++)
+            h = (h ^ data[i]) * 16777619u;
+    return h;
+}
+
+/**One serial link of a host gateway. Every Fire takes the next chunk of its recorded stream and decodes the frames in it**/
+struct GatewayLink : public SimpleConnection{
+    IOVector* stream;
+    atomic<int>* frames;
+    Packet chunk;
+    size_t offset = 0;
+    uint32_t digest = 0;
+
+    GatewayLink(IOVector* stream, atomic<int>* frames) : stream(stream), frames(frames), chunk(64){}
+
+    void Write(IO* io) override {}
+    uint32_t IdleFor() override { return 0; }            //The recorded stream is always ready
+
+    TaskReturn Fire() override {
+        if(offset >= stream->Size())
+            return Disposed;
+        auto n = min((size_t) 64, stream->Size() - offset);
+        chunk.Clear();
+        chunk.WriteBytes(stream->Interpret(offset), n);
+        chunk.SeekStart();
+        offset += n;
+        Receive(&chunk);
+        return Nothing;
+    }
+
+    void ReceivedMessage(Packet* p) override {
+        digest ^= bench_digest(p->Begin(), p->BytesAvailable());
+        (*frames)++;
+    }
+};
+
+/**8 gateway links plus 256 async decode jobs run on 1 to N threads**/
+void bench_executor(){
+    const int links = 8, frames_per_link = 2000, jobs = 256;
+    auto stream = bench_frame_stream(frames_per_link, 24, 3);
+    vector<uint8_t> blob(4096, 7);
+
+    vector<int> counts = {1, 2, 4};
+    int hw = max(1, (int) thread::hardware_concurrency());
+    if(hw > 4)
+        counts.push_back(hw);
+
+    println("Executor (8 links x 2000 frames + 256 async jobs, %i hardware threads)", hw);
+    double base = 0;
+    for(int threads : counts){
+        atomic<int> frames(0), done(0);
+        vector<unique_ptr<GatewayLink>> gateway;
+        for(int i = 0; i < links; i++)
+            gateway.emplace_back(new GatewayLink(&stream, &frames));
+
+        auto start = chrono::steady_clock::now();
+        {
+            Executor executor(threads);
+            for(auto& link : gateway)
+                executor.Start(link.get());
+            for(int i = 0; i < jobs; i++)
+                executor.Async(make_global_lambda(capture(&done, &blob), void, (), {
+                    if(bench_digest(blob.data(), blob.size()) != 0)
+                        done++;
+                }));
+            executor.Drain();
+        }
+        auto ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        if(threads == 1)
+            base = ms;
+        bool ok = frames == links * frames_per_link && done == jobs;
+        println("\tThreads=%i ms=%d Speedup=%d %s", threads, ms, base / ms, ok ? "Ok" : "LOST WORK");
+    }
+
+    //Tasks that do nothing, so all that is timed is the executor taking, firing and requeueing them
+    struct Counter : public Task{
+        int left;
+        explicit Counter(int left) : left(left){}
+        TaskReturn Fire() override { return --left == 0 ? Disposed : Nothing; }
+    };
+    const int counters = 8, firings = 50000;
+    println("Executor Overhead (%i tasks x %i empty firings)", counters, firings);
+    for(int threads : counts){
+        vector<Counter*> tasks;
+        for(int i = 0; i < counters; i++)
+            tasks.push_back(new Counter(firings));
+        auto start = chrono::steady_clock::now();
+        {
+            Executor executor(threads);
+            for(auto t : tasks)
+                executor.Start(t);
+            executor.Drain();
+        }
+        auto ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+        for(auto t : tasks)
+            delete t;
+        println("\tThreads=%i ns per firing=%d", threads, ns / (counters * firings));
+    }
+}
+
+uint32_t lambda_calls = 0;
+
+/**Make, pass on twice (to a task and a queue), call and drop a callback capturing two pointers and a counter**/
+void bench_lambda(){
+    int a = 0, b = 0;
+    uint32_t n = 0;
+    auto global = bench_ns(200000, [&]{
+        auto l = make_global_lambda(capture(&a, &b, n), void, (), a += n; b++);
+        auto c1 = l;
+        auto c2 = c1;
+        c2();
+        n++;
+    });
+    auto inline_ns = bench_ns(200000, [&]{
+        InlineLambda<void()> l = [&a, &b, n]{ a += n; b++; };
+        auto c1 = std::move(l);
+        auto c2 = std::move(c1);
+        c2();
+        n++;
+    });
+    auto stat = bench_ns(200000, [&]{
+        auto l = make_static_lambda(void, (), lambda_calls++);
+        auto c1 = l;
+        c1();
+    });
+    println("Lambda (make, pass on twice, call, drop)");
+    println("\tGlobal=%f Inline=%f Static=%f (b=%i)", global, inline_ns, stat, b);
+}
+
+/**Pass a ref through a queue of 8 (copy in, copy out, drop) with each count against std::shared_ptr. Then make and drop one**/
+template<typename R, typename F> void bench_ref_pass(const char* name, F make){
+    vector<R> queue(8);
+    auto r = make();
+    int i = 0;
+    auto pass_ns = bench_ns(1000000, [&]{
+        queue[i++ % 8] = r;
+        auto out = queue[i % 8];
+    });
+    auto make_ns = bench_ns(200000, [&]{ auto m = make(); });
+    println("\t%s: Pass=%f Make=%f", name, pass_ns, make_ns);
+}
+
+void bench_refs(){
+    println("Refs (ns)");
+    bench_ref_pass<std::shared_ptr<uint32_t>>("std::shared_ptr", []{ return std::shared_ptr<uint32_t>(new uint32_t(7)); });
+    bench_ref_pass<Shared<uint32_t, AtomicCount>>("AtomicCount", []{ return MakeRef<uint32_t>(Heap, 7u); });
+    bench_ref_pass<Shared<uint32_t, SingleCount>>("SingleCount", []{
+        auto b = RefBlock<SingleCount>::New(Heap, sizeof(uint32_t), nullptr);
+        return Shared<uint32_t, SingleCount>(new (b->Object()) uint32_t(7), b);
+    });
+}
+
+void run_benchmarks(){
+    bench_frame_decoder();
+    bench_ring();
+    bench_log();
+    bench_convert();
+    bench_byte_order();
+    bench_static_io();
+    bench_buffered_io();
+    bench_timers();
+    bench_task_churn();
+    bench_allocators();
+    bench_idle();
+    bench_virtual_clock();
+    bench_periodic();
+    bench_defer();
+    bench_locks();
+    bench_message_queue();
+    bench_executor();
+    bench_lambda();
+    bench_refs();
+}
+
+#endif
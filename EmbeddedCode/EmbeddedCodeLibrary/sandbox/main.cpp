@@ -1,9 +1,13 @@
 #define DEBUG
+//#define SIMPLE_PROFILE    //Time every task and print the stats after a few seconds
 
 #include <iostream>
 #include "../devices/SimplePC.hpp"
 #include "../SimpleDebug.hpp"
 #include "../SimpleConnection.hpp"
+#include "../SimpleCoroutine.hpp"
+#include "../SimpleLog.hpp"
+#include "bench.hpp"
 
 using namespace Simple;
 
@@ -64,6 +68,41 @@ void create_timer(int &var) {
     t->Start();
 }
 
+struct CountDown : public Coroutine{
+    int count = 3;
+
+    void Resume() override {
+        coroutine_begin();
+        while(count > 0){
+            println("Coroutine Count Down: %i", count--);
+            coroutine_wait(300);
+        }
+        println("Coroutine Finished!");
+        coroutine_end();
+    }
+};
+
+void test_coroutine() {
+    static CountDown countDown;
+    profileOnly(static Profile profile("Count Down", countDown);)
+    countDown.Start();
+}
+
+#ifdef SIMPLE_PROFILE
+/**Print the stats the way a host decodes them off a connection**/
+void test_profile() {
+    static Packet stats;
+    static Timer report(false, 2500);
+    report.callback = make_static_lambda(void, (Timer&), {
+        stats.Clear();
+        Log::WriteProfiles(stats);
+        stats.SeekStart();
+        LogTable::DecodeProfiles(stats, Out);
+    });
+    report.Start();
+}
+#endif
+
 void test_async() {
     async([], println("My Async Task!"));
     println("Post Async Init, Pre Async Print!");
@@ -127,9 +166,14 @@ void test_io() {
     println("Finished IO Testing!");
 }
 
-int main() {
+int main(int argc, char** argv) {
     int local_var = 7;
 
+    if(argc > 1 && strcmp(argv[1], "bench") == 0){
+        run_benchmarks();
+        return 0;
+    }
+
     if (!InitializeIO())
         printf("Wrong Endian Type!");
 
@@ -137,5 +181,7 @@ int main() {
     test_io();
     create_timer(local_var);
     test_async();
+    test_coroutine();
+    profileOnly(test_profile());
     test_connection();
 }
\ No newline at end of file
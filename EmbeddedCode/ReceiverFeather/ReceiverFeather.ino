@@ -13,8 +13,8 @@
 
 /*Override std print to divert to Computer
   Put this before the feather lib so that we can read errors from device */
-void serial_print(const char* fmt, ...);
-#define print(fmt, ...) serial_print(fmt, ##__VA_ARGS__)
+template<typename F, typename... Args> void serial_print(F fmt, Args... args);
+#define print(fmt, ...) serial_print(SimpleFormat(fmt), ##__VA_ARGS__)
 #define printrx(fmt, ...) print("[Rx]:" fmt, ##__VA_ARGS__)
 #define printrxln(fmt, ...) println("[Rx]:" fmt, ##__VA_ARGS__)
 
@@ -32,7 +32,8 @@ enum PacketType : uint8_t{
   AccelerationPacket = 1,
   ComputerPrint,
   SetMotorSpeed,
-  Cut
+  Cut,
+  ComputerLog = 6
 };
 
 enum Device : uint8_t{
@@ -47,7 +48,8 @@ enum Device : uint8_t{
 struct SimpleComputerPacket : public Packet{
   uint8_t id;
 
-  SimpleComputerPacket(int capacity) : Packet(capacity){}
+  //Room for the packet id and the SimpleConnection framing so nothing gets shifted when sending
+  SimpleComputerPacket(int capacity) : Packet(capacity, SimpleConnection::Headroom + 1, SimpleConnection::Tailroom){}
 
   void config(uint8_t type, bool reset=true){
     id = type;
@@ -63,6 +65,7 @@ struct RxSimpleCompConnection : public SimpleConnection{
     RxSimpleCompConnection(RxCompConnection* c) : rxc(c){}
 
     void ReceivedMessage(Packet* io) final;
+    void WriteV(IOSlice* slices, int count) final;
 
     protected:
     void Write(IO* io) final;
@@ -76,11 +79,16 @@ struct RxCompConnection : public SerialConnection{
 
   RxCompConnection() : sc(this), SerialConnection(256) {}
 
-  void SendPacket(SimpleComputerPacket* p){
-    p->InsertRange(0, 1);
-    *p->Interpret(0) = p->id;    //Set first byte to be the id of the packet
+  //Send the id of the packet followed by its contents without copying them
+  bool SendPacket(uint8_t id, Packet* p){
+    IOSlice payload[] = {{&id, 1}, {p->Interpret(0), (int) p->Size()}};
+    return sc.SendV(payload, 2);    //False if the packet is too long for one frame
+  }
+
+  bool SendPacket(SimpleComputerPacket* p){
+    *p->Prepend(1) = p->id;      //Set first byte to be the id of the packet
     p->SeekStart();
-    sc.Send(p);
+    return sc.Send(p);
   }
 
   void Receive(Packet* p) final { 
@@ -94,12 +102,12 @@ Timer heartBeat(true, 2000);    //Used to prevent motor from turning off from lo
 struct RxRxRadioConnection : public RadioConnection{
   RxRxRadioConnection() : RadioConnection(RFM95_Slave, RFM95_Interrupt, RFM95_Reset, 256) { SetAddress(Rxer); }
 
-  void SendPacket(RadioPacket* p){
+  bool SendPacket(RadioPacket* p){
     if(p->to == Ctrlr)
       heartBeat.Reset();
 
     p->SeekStart();
-    Send(p);
+    return Send(p);
   }
 
   void Receive(RadioPacket* io) final;
@@ -110,15 +118,10 @@ RxRxRadioConnection rx;
 SimpleComputerPacket scp1 = SimpleComputerPacket(256);
 RadioPacket rp1 = RadioPacket(256);
 
-void serial_print(const char* fmt, ...){
-  va_list args;
-  va_start(args, fmt);
-  
+template<typename F, typename... Args> void serial_print(F fmt, Args... args){
   scp1.config(PacketType::ComputerPrint);
-  scp1.vPrintf((char*) fmt, args);
+  scp1.Printf(fmt, args...);
   computer.SendPacket(&scp1);
-
-  va_end(args);
 }
 
 void setup() {
@@ -150,6 +153,7 @@ void loop() {
 }
 
 void RxSimpleCompConnection::Write(IO* io){ rxc->Write(io); }
+void RxSimpleCompConnection::WriteV(IOSlice* slices, int count){ rxc->WriteV(slices, count); }
 
 //Method called when a packet from the computer is received
 void RxSimpleCompConnection::ReceivedMessage(Packet* p){
@@ -169,10 +173,9 @@ void RxSimpleCompConnection::ReceivedMessage(Packet* p){
 void RxRxRadioConnection::Receive(RadioPacket* p) {
   switch(p->id){
     case PacketType::ComputerPrint:     //Forward to the computer
+    case PacketType::ComputerLog:
     case PacketType::AccelerationPacket:
-        scp1.config(p->id);
-        scp1.ReadFrom(*p);
-        computer.SendPacket(&scp1);
+        computer.SendPacket(p->id, p);
       break;  
   }
 }
\ No newline at end of file
@@ -16,14 +16,18 @@
   Put this before the feather lib so that we can read errors from device */
 
 //#define DEBUG
+//#define BINARY_LOG    //Send prints as a format id + raw arguments. SpinorGUI cannot read them, decode them with a host tool built on Simple::LogTable
+//#define SIMPLE_PROFILE    //Time the tasks. Send the stats with Log::WriteProfiles and decode them with LogTable::DecodeProfiles
 
-void radio_print(const char* fmt, ...);
-#define print(fmt, ...) radio_print(fmt, ##__VA_ARGS__)
+template<typename F, typename... Args> void radio_print(F fmt, Args... args);
+#define print(fmt, ...) radio_print(SimpleFormat(fmt), ##__VA_ARGS__)
 #define printtx(fmt, ...) print("[Tx]:" fmt, ##__VA_ARGS__)
 #define printtxln(fmt, ...) println("[Tx]:" fmt, ##__VA_ARGS__)
 
 #include <SimpleConnection.hpp>
 #include <SimpleTimer.hpp>
+#include <SimpleCoroutine.hpp>
+#include <SimpleLog.hpp>
 #include <devices/SimpleFeather.hpp>
 
 // The SFE_LSM9DS1 library requires both Wire and SPI to be
@@ -44,7 +48,8 @@ enum PacketType : uint8_t{
   AccelerationPacket = 1,
   ComputerPrint,
   SetMotorSpeed,
-  Cut
+  Cut,
+  ComputerLog = 6
 };
 
 enum Device : uint8_t{
@@ -60,31 +65,44 @@ enum Device : uint8_t{
 struct TxRxRadioConnection : public RadioConnection{
   TxRxRadioConnection() : RadioConnection(RFM95_Slave, RFM95_Interrupt, RFM95_Reset, 256) { SetAddress(Txer); }
 
-  void SendPacket(RadioPacket* p){
+  bool SendPacket(RadioPacket* p){
     p->SeekStart();
-    Send(p);
+    return Send(p);
   }
 
   void Receive(RadioPacket* io) final;
 };
 
+//Fire the cutter for a second
+struct CutSequence : public Coroutine{
+  void Resume() override {
+    coroutine_begin();
+    digitalWrite(CutPin, HIGH);
+    coroutine_wait(1000);
+    digitalWrite(CutPin, LOW);
+    coroutine_end();
+  }
+};
+
 LSM9DS1 imu;
 TxRxRadioConnection tx;
-Timer packetTimer(true, 500), cutTimer(false, 1000);
+PeriodicTimer packetTimer(500);     //Phase locked so the gyro samples stay evenly spaced
+CutSequence cut;
 RadioPacket rp1 = RadioPacket(256);
+profileOnly(Profile packetProfile("Packet Timer", packetTimer), radioProfile("Radio", tx);)
 
 //Simple::Printf implementation stream to Rx
-void radio_print(const char* fmt, ...){
-  va_list args;
-  va_start(args, fmt);
-
+template<typename F, typename... Args> void radio_print(F fmt, Args... args){
+#ifdef BINARY_LOG
+  rp1.config(Master, PacketType::ComputerLog);
+  Log::Write(rp1, fmt, args...);
+#else
   rp1.config(Master, PacketType::ComputerPrint);
-  rp1.vPrintf((char*) fmt, args);
+  rp1.Printf(fmt, args...);
+#endif
   tx.SendPacket(&rp1);
 
-  debugOnly( Out.vPrintf((char*) fmt, args); )
-
-  va_end(args);
+  debugOnly( Out.Printf(fmt, args...); )
 }
 
 void setup() {
@@ -101,8 +119,6 @@ void setup() {
   delay(100);
   printtxln("LoRa Radio Okay!");
 
-  cutTimer.callback = make_static_lambda(void, (Timer& t), digitalWrite(CutPin, LOW));
-
   packetTimer.callback = make_static_lambda(void, (Timer& t), {
     float Gz = imu.calcGyro(imu.gz);
 /*  
@@ -153,8 +169,7 @@ void loop() {
 void TxRxRadioConnection::Receive(RadioPacket* p) {
   switch(p->id){
       case Cut:
-        digitalWrite(CutPin, HIGH);
-        cutTimer.Start();
+        cut.Restart();
         break;
   }
 }
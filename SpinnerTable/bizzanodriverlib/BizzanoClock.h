@@ -0,0 +1,43 @@
+/*Author: Johnathan Bizzano
+ * Date 10/17/2026
+ * Purpose: Monotonic microsecond clock. Timer0_A counts SMCLK (1Mhz) in continuous mode and its overflow interrupt
+ *          extends the 16 bit count to 64 bits so the clock never wraps
+ * **/
+
+#ifndef SPINNERTABLE_BIZZANOCLOCK_H
+#define SPINNERTABLE_BIZZANOCLOCK_H
+
+#define BIZZANO_CLOCK_BASE TIMER_A0_BASE
+
+volatile uint64_t bizzano_clock_high = 0;     //Count of the upper 48 bits. Only the overflow interrupt writes it
+
+void BizzanoClock_Init(){
+    Timer_A_clearTimerInterrupt(BIZZANO_CLOCK_BASE);
+    Timer_A_initContinuousModeParam init = {0};
+    init.clockSource = TIMER_A_CLOCKSOURCE_SMCLK;
+    init.clockSourceDivider = TIMER_A_CLOCKSOURCE_DIVIDER_1;   //1 tick per us, overflows every 65.5ms
+    init.timerInterruptEnable_TAIE = TIMER_A_TAIE_INTERRUPT_ENABLE;
+    init.timerClear = TIMER_A_DO_CLEAR;
+    init.startTimer = false;
+    Timer_A_initContinuousMode(BIZZANO_CLOCK_BASE, &init);
+    Timer_A_startCounter(BIZZANO_CLOCK_BASE, TIMER_A_CONTINUOUS_MODE);
+}
+
+//Call from the TIMER0_A1 interrupt on TA0IV_TAIFG
+void BizzanoClock_Overflow(){ bizzano_clock_high += 0x10000; }
+
+//Microseconds since BizzanoClock_Init. Safe from interrupts and the main loop
+uint64_t BizzanoClock_Micros(){
+    unsigned short state = __get_interrupt_state();
+    __disable_interrupt();
+    uint16_t low = Fast_Timer_A_getCounterValue(BIZZANO_CLOCK_BASE);
+    uint64_t high = bizzano_clock_high;
+    if((HWREG16(BIZZANO_CLOCK_BASE + OFS_TAxCTL) & TAIFG) && low < 0x8000)
+        high += 0x10000;                //Wrapped but the interrupt has not run yet
+    __set_interrupt_state(state);
+    return high | low;
+}
+
+uint32_t BizzanoClock_Millis(){ return (uint32_t) (BizzanoClock_Micros() / 1000); }
+
+#endif //SPINNERTABLE_BIZZANOCLOCK_H
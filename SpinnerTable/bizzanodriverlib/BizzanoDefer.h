@@ -0,0 +1,56 @@
+/*Author: Johnathan Bizzano
+ * Date 10/17/2026
+ * Purpose: Lock free queue of calls an interrupt hands to the main loop so the slow part of the work (printing over
+ *          the UART) runs outside the interrupt. One producer (interrupts do not nest here) and the main loop as the
+ *          consumer. A full queue drops the call and counts it. The capacity must be a power of two
+ * **/
+
+#ifndef SPINNERTABLE_BIZZANODEFER_H
+#define SPINNERTABLE_BIZZANODEFER_H
+
+typedef void (*BizzanoDeferCall)(uint32_t arg);
+
+typedef struct BizzanoDeferEntry{
+    BizzanoDeferCall call;
+    uint32_t arg;
+} BizzanoDeferEntry;
+
+typedef struct BizzanoDefer{
+    BizzanoDeferEntry* entries;
+    uint16_t mask;
+    volatile uint16_t head, tail;       //Free running. Only the producer writes head and only the consumer writes tail
+    volatile uint16_t overflows;        //Calls dropped because the queue was full
+} BizzanoDefer;
+
+//Define a queue with its own static storage
+#define BizzanoDefer_Define(name, capacity)             \
+    BizzanoDeferEntry CAT(name, _entries)[capacity];    \
+    BizzanoDefer name = { CAT(name, _entries), (capacity) - 1, 0, 0, 0 }
+
+uint16_t BizzanoDefer_Count(BizzanoDefer* q){ return q->head - q->tail; }
+
+//Producer: Queue call(arg). Returns false and counts an overflow if the queue is full
+bool BizzanoDefer_Post(BizzanoDefer* q, BizzanoDeferCall call, uint32_t arg){
+    uint16_t h = q->head;
+    if((uint16_t) (h - q->tail) > q->mask){
+        q->overflows++;
+        return false;
+    }
+    q->entries[h & q->mask].call = call;
+    q->entries[h & q->mask].arg = arg;
+    q->head = h + 1;                    //Publish after the entry is stored
+    return true;
+}
+
+//Consumer: Run the calls queued so far. Calls posted meanwhile wait for the next pass so the loop is never held up
+uint16_t BizzanoDefer_Run(BizzanoDefer* q){
+    uint16_t t = q->tail, end = q->head, ran = end - t;
+    for(; t != end; t++){
+        BizzanoDeferEntry e = q->entries[t & q->mask];
+        q->tail = t + 1;                //Free the slot before the call
+        e.call(e.arg);
+    }
+    return ran;
+}
+
+#endif //SPINNERTABLE_BIZZANODEFER_H
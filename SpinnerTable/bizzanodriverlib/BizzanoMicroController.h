@@ -16,6 +16,11 @@
     #define __interrupt
     #define __even_in_range(reg, x) reg
     #define __enable_interrupt()
+    #define __disable_interrupt()
+    #define __bis_SR_register(x)
+    #define __bic_SR_register_on_exit(x)
+    #define __get_interrupt_state() 0
+    #define __set_interrupt_state(x)
 #else
     #include <msp430.h>
 #endif
@@ -84,5 +89,8 @@ uint16_t Fast_Timer_A_getCounterValue(uint16_t baseAddress){ return HWREG16(base
 void Fast_Timer_A_setCounterValue(uint16_t baseAddress, long v){ HWREG16(baseAddress + OFS_TAxR) = v; }
 
 #include "BizzanoMFIO.h"
+#include "BizzanoRing.h"
+#include "BizzanoClock.h"
+#include "BizzanoDefer.h"
 
 #endif // _BIZZANO_MC_H_
\ No newline at end of file
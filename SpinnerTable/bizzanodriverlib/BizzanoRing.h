@@ -0,0 +1,57 @@
+/*Author: Johnathan Bizzano
+ * Date 10/17/2026
+ * Purpose: Lock free single producer / single consumer byte ring. Lets an interrupt hand bytes to the main loop
+ *          without disabling interrupts. The capacity must be a power of two
+ * **/
+
+#ifndef SPINNERTABLE_BIZZANORING_H
+#define SPINNERTABLE_BIZZANORING_H
+
+typedef struct BizzanoRing{
+    uint8_t* buffer;
+    uint16_t mask;
+    volatile uint16_t head, tail;       //Free running. Only the producer writes head and only the consumer writes tail
+    volatile uint16_t overflows;        //Bytes dropped because the ring was full
+} BizzanoRing;
+
+//Define a ring with its own static storage
+#define BizzanoRing_Define(name, capacity) \
+    uint8_t CAT(name, _buffer)[capacity];   \
+    BizzanoRing name = { CAT(name, _buffer), (capacity) - 1, 0, 0, 0 }
+
+uint16_t BizzanoRing_Count(BizzanoRing* r){ return r->head - r->tail; }
+
+//Producer: Add a byte. Returns false and counts an overflow if the ring is full
+bool BizzanoRing_Push(BizzanoRing* r, uint8_t b){
+    uint16_t h = r->head;
+    if((uint16_t) (h - r->tail) > r->mask){
+        r->overflows++;
+        return false;
+    }
+    r->buffer[h & r->mask] = b;
+    r->head = h + 1;                    //Publish after the byte is stored
+    return true;
+}
+
+//Consumer: Remove the oldest byte. Returns false if the ring is empty
+bool BizzanoRing_Pop(BizzanoRing* r, uint8_t* b){
+    uint16_t t = r->tail;
+    if(t == r->head)
+        return false;
+    *b = r->buffer[t & r->mask];
+    r->tail = t + 1;
+    return true;
+}
+
+//Consumer: Get the contiguous readable bytes without removing them
+uint16_t BizzanoRing_Peek(BizzanoRing* r, uint8_t** ptr){
+    uint16_t t = r->tail & r->mask;
+    uint16_t count = BizzanoRing_Count(r), contiguous = r->mask + 1 - t;
+    *ptr = r->buffer + t;
+    return count < contiguous ? count : contiguous;
+}
+
+//Consumer: Remove $n peeked bytes
+void BizzanoRing_Commit(BizzanoRing* r, uint16_t n){ r->tail += n; }
+
+#endif //SPINNERTABLE_BIZZANORING_H
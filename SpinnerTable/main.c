@@ -15,7 +15,8 @@
      ADCMEM0 - Motor ADC Memory
 
     Timers:
-     A0 - IR Timer
+     A0 - Microsecond Clock
+     A1 - IR Stall Timeout
 
     UART
      A0 - PC
@@ -42,9 +43,10 @@
 #define ADC_IR_SAMPLES 4
 
 #define ACLK_FREQ 32768
-#define ConversionFactorFreqForFreq (double) (32768)/32
+#define MICROS_PER_SECOND 1000000.0
 
 int ir_state = 0, adc_samples = 0;
+uint64_t ir_start = 0;     //BizzanoClock_Micros() when the current revolution started
 bool ir_triggered = false;
 float adc_avg = 0;
 
@@ -104,26 +106,32 @@ void init_motor_uart(){
 void motor_uart_write(uint8_t v){ EUSCI_A_UART_transmitData(MOTOR_UART_BASE, v); }
 void write_Freq(double speed){println("\r\nFreq%d", speed);}
 
+BizzanoRing_Define(pc_rx, 32);     //Bytes from the PC. Filled by USCI_A0_ISR and handled in the main loop
+BizzanoDefer_Define(deferred, 8);  //Reports the interrupts leave for the main loop. Printing blocks on the UART
+
+void on_pc_byte(uint8_t k){
+    if(k <= 127){
+        motor_uart_write(0xC2);
+        motor_uart_write(k);
+        ir_state = 0; //Reset the IR state so that Freq is not miscalculated
+    }else{
+        switch(k){
+            case 128: GPIO_setOutputHighOnPin(RELEASE_GPIO_PORT); break;
+            case 129: GPIO_setOutputLowOnPin(RELEASE_GPIO_PORT); break;
+            default: debug("Found Invalid Recieve Byte!");
+        }
+    }
+}
+
 #pragma vector = USCI_A0_VECTOR
 __interrupt void USCI_A0_ISR(void) {
     switch(__even_in_range(UCA0IV, USCI_UART_UCTXCPTIFG)) {
         case USCI_NONE:
             break;
-        case USCI_UART_UCRXIFG: {
-                uint8_t k = EUSCI_A_UART_receiveData(UART_BACKCHANNEL_BASE);
-                if(k <= 127){
-                    motor_uart_write(0xC2);
-                    motor_uart_write(k);
-                    ir_state = 0; //Reset the IR state so that Freq is not miscalculated
-                }else{
-                    switch(k){
-                        case 128: GPIO_setOutputHighOnPin(RELEASE_GPIO_PORT); break;
-                        case 129: GPIO_setOutputLowOnPin(RELEASE_GPIO_PORT); break;
-                        default: debug("Found Invalid Recieve Byte!");
-                    }
-                }
-                ADC12_B_clearInterrupt(EUSCI_A0_BASE, 0, USCI_UART_UCRXIFG);
-            }
+        case USCI_UART_UCRXIFG:
+            BizzanoRing_Push(&pc_rx, EUSCI_A_UART_receiveData(UART_BACKCHANNEL_BASE));
+            ADC12_B_clearInterrupt(EUSCI_A0_BASE, 0, USCI_UART_UCRXIFG);
+            __bic_SR_register_on_exit(LPM0_bits);      //Wake the main loop to handle the byte
             break;
         case USCI_UART_UCSTTIFG: break;
     }
@@ -160,16 +168,21 @@ void adc_init(){
     ADC12_B_startConversion(ADC12_B_BASE, MOTOR_ADC_OUTPUT, ADC12_B_REPEATED_SINGLECHANNEL);
 }
 
+void report_revolution(uint32_t micros){ write_Freq(MICROS_PER_SECOND / (double) micros); }
+
+//Runs in ADC12_ISR. The clock is read here so the period is exact to the microsecond, the report is deferred
 void on_adc_sample(float value){
     bool wasTripped = value < IR_TRIP_COUNT;
     bool stateChange = wasTripped != ir_triggered;
     ir_triggered = wasTripped;
     if(stateChange){
-        if(ir_state++ == 0)
-                Fast_Timer_A_setCounterValue(IR_TIMER_BASE, 0); //Start the clock
+        if(ir_state++ == 0){
+            ir_start = BizzanoClock_Micros();
+            Fast_Timer_A_setCounterValue(IR_TIMER_BASE, 0); //Restart the stall timeout
+        }
         if(ir_state == 6){ //6 Different States Per Rev
             ir_state = 0; //Reset
-            write_Freq((ConversionFactorFreqForFreq / (double) Fast_Timer_A_getCounterValue(IR_TIMER_BASE)));
+            BizzanoDefer_Post(&deferred, report_revolution, (uint32_t) (BizzanoClock_Micros() - ir_start));
         }
     }
 }
@@ -183,6 +196,8 @@ __interrupt void ADC12_ISR(void) {
                 on_adc_sample(adc_avg/ADC_IR_SAMPLES);
                 adc_avg = 0;
                 adc_samples = 0;
+                if(BizzanoDefer_Count(&deferred) != 0)
+                    __bic_SR_register_on_exit(LPM0_bits);      //Wake the main loop to send the report
             }
             ADC12_B_clearInterrupt(ADC12_B_BASE, 0, ADC12_B_IFG0); //Doesnt Clear Auto?? MUST HAVE THIS!!
             break;
@@ -193,7 +208,7 @@ void init_ir_timer(){
     Timer_A_clearTimerInterrupt(IR_TIMER_BASE);
     Timer_A_initContinuousModeParam init = {0};
     init.clockSource = TIMER_A_CLOCKSOURCE_ACLK;
-    init.clockSourceDivider = TIMER_A_CLOCKSOURCE_DIVIDER_32; //Reset every 64 seconds (65535/(32768/32))
+    init.clockSourceDivider = TIMER_A_CLOCKSOURCE_DIVIDER_32; //Overflows 64 seconds into a revolution (65535/(32768/32))
     init.timerInterruptEnable_TAIE = TIMER_A_TAIE_INTERRUPT_ENABLE;
     init.timerClear = TIMER_A_DO_CLEAR;
     init.startTimer = false;
@@ -201,18 +216,31 @@ void init_ir_timer(){
     Timer_A_startCounter(IR_TIMER_BASE, TIMER_A_CONTINUOUS_MODE);
 }
 
+void report_ir_timeout(uint32_t unused){
+    write_Freq(0);
+    debug("Timer OverFlow!");
+}
+
 #pragma vector=TIMER1_A1_VECTOR
 __interrupt void TIMER1_A1_ISR(void) {
     switch (__even_in_range(TA1IV, 14)){
         case 14: // overflow
-            write_Freq(0);
-            debug("Timer OverFlow!");
+            BizzanoDefer_Post(&deferred, report_ir_timeout, 0);
+            __bic_SR_register_on_exit(LPM0_bits);
             break;
         default: break;
     }
     Timer_A_clearTimerInterrupt(IR_TIMER_BASE);
 }
 
+#pragma vector=TIMER0_A1_VECTOR
+__interrupt void TIMER0_A1_ISR(void) {
+    switch (__even_in_range(TA0IV, TA0IV_TAIFG)){
+        case TA0IV_TAIFG: BizzanoClock_Overflow(); break;
+        default: break;
+    }
+}
+
 void init_release(){
     GPIO_setAsOutputPin(RELEASE_GPIO_PORT);
     GPIO_setOutputLowOnPin(RELEASE_GPIO_PORT);
@@ -230,6 +258,7 @@ int main(void) {
     HoldWatchDogTimer();
     PMM_unlockLPM5();
     init_smclock();
+    BizzanoClock_Init();
     init_pc_uart();
     init_aclk();
     init_motor_uart();
@@ -239,11 +268,16 @@ int main(void) {
     __enable_interrupt();
 
     unsigned int cycle_count = 0;
+    uint8_t pc_byte;
 
     while(true){
+        while(BizzanoRing_Pop(&pc_rx, &pc_byte))
+            on_pc_byte(pc_byte);
+        BizzanoDefer_Run(&deferred);
+
 #ifdef DEBUG
         if(cycle_count++ % 1000 == 0){
-            println("HeartBeat: %u", cycle_count);
+            println("HeartBeat: %u Dropped Reports: %u", cycle_count, deferred.overflows);
          /* set_motor_joint_mode();
             motor_uart_write(0x9F);
             motor_uart_write(0x7B);
@@ -251,6 +285,13 @@ int main(void) {
         }
 #endif
 
+        //Sleep until an interrupt hands over a byte or a report. LPM0 since the UARTs run from SMCLK.
+        //Interrupts stay off between the check and the sleep so nothing can slip in unnoticed
+        __disable_interrupt();
+        if(BizzanoRing_Count(&pc_rx) == 0 && BizzanoDefer_Count(&deferred) == 0)
+            __bis_SR_register(LPM0_bits | GIE);
+        else
+            __enable_interrupt();
     }
 }
 